@@ -12,6 +12,7 @@
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "C_ppm_writer.h"	// bulk PPM writer (P3 text formatted from a lookup table, written in large chunks)
 
 using namespace std;	// kinda like allowing collections.deque() --> deque(); std::cout -> cout
 
@@ -26,9 +27,6 @@ int main()
 
 	std::vector<unsigned char> image(nx * ny * 3);	// dynamic array of elements of type 'unsigned char', which is a type that can hold values in 0~255; size nx * ny * 3 
 
-	ofstream outfile("C:/Users/ohjin/OneDrive/문서/GitHub/RayTracing/RayTracing/firstP3.ppm");					// open output file in text mode
-	outfile << "P3\n" << nx << " " << ny << "\n255\n";	// write PPM header (P3 format); P3 indicates ASCII PPM file; nx ny are w & h; 255 max color value of each channel; " " inserts a space
-	
 	int idx = 0;	// idx for image array
 	for (int j = ny - 1; j >= 0; j--)	{				// loop over rows from top to bottom (PPM expects top to bottom)
 		for (int i = 0; i < nx; i++) {					// loop over cols from left to right
@@ -38,20 +36,17 @@ int main()
 			float b = 0.2;								// blue constant at 20% brightness
 
 			// Convert floats into integer RGB values (0-255)
-			int ir = int(255.99 * r);
-			int ig = int(255.99 * g);
-			int ib = int(255.99 * b);
-
 			image[idx++] = (unsigned char)(255.99 * r);
 			image[idx++] = (unsigned char)(255.99 * g);
 			image[idx++] = (unsigned char)(255.99 * b);
-
-			// std::cout << ir << " " << ig << " " << ib << "\n";	// print pixels
-			// Write pixel values into file
-			outfile << ir << " " << ig << " " << ib << "\n";
 		}
 	}
 
+	// Write the whole buffer as an ASCII PPM (P3) in one go instead of streaming each pixel through ofstream
+	if (!write_ppm("C:/Users/ohjin/OneDrive/문서/GitHub/RayTracing/RayTracing/firstP3.ppm", image.data(), nx, ny, PpmFormat::P3)) {
+		std::cout << "Failed to write firstP3.ppm!\n";
+	}
+
 	// Files saved at C:\Users\ohjin\OneDrive\문서\GitHub\RayTracing\out\build\x64-debug\RayTracing unless specified
 	if (stbi_write_jpg("C:/Users/ohjin/OneDrive/문서/GitHub/RayTracing/RayTracing\\firstP3.jpg", nx, ny, 3, image.data(), 90)) {
 		std::cout << "Wrote firstP3.jpg\n";
@@ -60,8 +55,6 @@ int main()
 		std::cout << "Failed to write image!\n";
 	}
 
-	outfile.close();		// close file to save data to disk
-
 	cout << "Image written to firstP3.ppm" << endl;
 	return 0;
 }
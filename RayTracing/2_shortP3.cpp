@@ -1,7 +1,11 @@
 #include "color.h"
 #include "vec3.h"
 
+#include "C_ppm_writer.h"     // bulk P3 writer, instead of write_color per pixel
+
 #include <iostream>
+#include <vector>
+#include <cstdio>       // stdout
 
 int main() {
 
@@ -10,17 +14,23 @@ int main() {
     int image_width = 256;
     int image_height = 256;
 
-    // Render
+    // Render into an RGB buffer first; the same bytes write_color would print
 
-    std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+    std::vector<uint8_t> image(image_width * image_height * 3);
 
     for (int j = 0; j < image_height; j++) {
         std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
         for (int i = 0; i < image_width; i++) {
             auto pixel_color = color(double(i) / (image_width - 1), double(j) / (image_height - 1), 0);
-            write_color(std::cout, pixel_color);
+            uint8_t* p = &image[3 * (j * image_width + i)];
+            p[0] = uint8_t(int(255.999 * pixel_color.x()));
+            p[1] = uint8_t(int(255.999 * pixel_color.y()));
+            p[2] = uint8_t(int(255.999 * pixel_color.z()));
         }
     }
 
+    // Then write the whole P3 image to stdout with a few large writes
+    write_ppm(stdout, image.data(), image_width, image_height, PpmFormat::P3);
+
     std::clog << "\rDone.                 \n";
 }
\ No newline at end of file
@@ -1,9 +1,20 @@
 #include "color.h"
 #include "ray.h"
 #include "vec3.h"
+#include "sphere.h"
+#include "bvh.h"
+#include "C_sampler.h"      // pixel sample positions for --spp
+#include "C_cpu_dispatch.h" // SIMD camera ray directions for the one-ray-per-pixel loop
+#include "C_adaptive.h"     // variance-driven sample allocation for --adaptive / --budget
+#include "C_deadline.h"     // time-budgeted passes for --deadline
+
+#include <limits>       // infinity for the initial ray_tmax
 
 #include <iostream>
 #include <vector>       // vector, for writing pixel rgb to jpg
+#include <string>
+#include <type_traits>  // std::is_same_v: SIMD ray directions only in the float build
+#include <cstdlib>      // std::atoi, std::atof, std::strtoull for the command line
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -25,9 +36,15 @@ Currently, the image is all black, but if a background, a sphere, normals, etc a
 */
 
 
-color ray_color(const ray& r) {
+color ray_color(const ray& r, const hittable& world) {
     // return color(0, 0, 0);          // for now, fix it to color black (0,0,0)
 
+    // If the ray hits an object, shade it by its surface normal mapped from [-1,1] to [0,1] per component
+    hit_record rec;
+    if (world.hit(r, 0, std::numeric_limits<real>::infinity(), rec)) {
+        return 0.5 * (rec.normal + color(1, 1, 1));
+    }
+
     // Create a white~blue background as a simple sky with vertical gradient
     vec3 unit_direction = unit_vector(r.direction());   // 3D unit vector of the ray direction
     // Use y-value of unit_direction to decide how much blue vs white to blend
@@ -41,7 +58,31 @@ color ray_color(const ray& r) {
     return (1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0); // lerp equation for white-to-blue gradient; a=1 for blue(end), a=0 for white(start)
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    // Samples per pixel: main [--spp N] [--sampler independent|stratified|halton|sobol] [--adaptive ERROR] [--budget SAMPLES] [--deadline MS]
+    // Without arguments there is one ray through each pixel center, as before; --adaptive / --budget turn N into the per-pixel cap (C_adaptive.h; AdaptiveSettings::max_spp without --spp)
+    // --deadline renders passes until MS milliseconds are nearly spent (C_deadline.h), at most N if --spp is given
+    int spp = 1;
+    std::string sampler_name = "sobol";
+    float adaptive_error = 0.0f;
+    unsigned long long sample_budget = 0;
+    double deadline_ms = 0.0;
+    bool spp_given = false;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--spp" && a + 1 < argc) { spp = std::max(1, std::atoi(argv[++a])); spp_given = true; }
+        else if (arg == "--sampler" && a + 1 < argc) sampler_name = argv[++a];
+        else if (arg == "--adaptive" && a + 1 < argc) adaptive_error = float(std::atof(argv[++a]));
+        else if (arg == "--budget" && a + 1 < argc) sample_budget = std::strtoull(argv[++a], nullptr, 10);
+        else if (arg == "--deadline" && a + 1 < argc) deadline_ms = std::atof(argv[++a]);
+        else {
+            std::cerr << "usage: main [--spp N] [--sampler independent|stratified|halton|sobol] [--adaptive ERROR] [--budget SAMPLES] [--deadline MS]\n";
+            return 1;
+        }
+    }
+    const bool adaptive = adaptive_error > 0.0f || sample_budget > 0;
+    if (adaptive && !spp_given) spp = AdaptiveSettings{}.max_spp;     // no cap given: the adaptive default, not 1 spp, which would stop after the first batch
 
     // Image
 
@@ -53,6 +94,12 @@ int main() {
     int image_height = int(image_width / aspect_ratio);
     image_height = (image_height < 1) ? 1 : image_height;       // image height must be at least 1, so return 1 if smaller, else image_height
 
+    // World - spheres go through a BVH (bvh.h), so adding many more of them keeps ray_color's cost roughly logarithmic
+    std::vector<sphere> spheres;
+    spheres.push_back(sphere(point3(0, 0, -1), 0.5));
+    spheres.push_back(sphere(point3(0, -100.5, -1), 100));     // large sphere as the ground
+    bvh world(spheres);
+
     // Camera
         // auto tells the compiler to deduce the type of a variable from its initializer and allcate the proper amount of memory
     auto focal_length = 1.0;        // distance from camera center to image plane along the -Z (into the image)
@@ -89,26 +136,89 @@ int main() {
         // std::cout << "P3\n" << "# image_width: " << image_width << " image_height: " << image_height << "\n" << image_width << ' ' << image_height << "\n255\n"; 
     std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
 
-    for (int j = 0; j < image_height; j++) {
-        std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
-        for (int i = 0; i < image_width; i++) {
-            auto pixel_center = pixel00_loc + (i * pixel_delta_u) + (j * pixel_delta_v);    // coordinates of each (i,j)-th pixel's center
-            auto ray_direction = pixel_center - camera_center;      // ray direction from camera to pixel center, but not unit vector for code simplicity
-            ray r(camera_center, ray_direction);    // a ray class object is defined by origin of the ray (camera_center), direction of the ray (ray_direction) and a function at(t) to get a point along the ray (origin + t*direction) <- half ray if positive!
+    if (spp > 1 || adaptive || deadline_ms > 0.0) {
+        // Several jittered rays per pixel, averaged in a float AccumBuffer and shaded on all cores; sample positions come from the sampler,
+        // keyed by pixel and sample index, so the image does not depend on the thread count
+        std::unique_ptr<Sampler> sampler = make_sampler(sampler_name, spp, 1);
+        if (!sampler) {
+            std::cerr << "unknown sampler '" << sampler_name << "'\n";
+            return 1;
+        }
+        AccumBuffer acc(image_width, image_height);
+        auto shade = [&](int i, int j, uint32_t s, float* rgb) {
+            float u, v;
+            sampler->sample_2d(uint32_t(i), uint32_t(j), s, 0, u, v);      // dimensions 0-1: position inside the pixel
+            auto pixel_sample = pixel00_loc + ((i + u - 0.5) * pixel_delta_u) + ((j + v - 0.5) * pixel_delta_v);
+            color c = ray_color(ray(camera_center, pixel_sample - camera_center), world);
+            rgb[0] = float(c.x());
+            rgb[1] = float(c.y());
+            rgb[2] = float(c.z());
+            };
+
+        Image resolved(image_width, image_height);
+        if (deadline_ms > 0.0) {
+            DeadlineSettings cfg;
+            cfg.budget_ms = deadline_ms;
+            cfg.max_passes = spp_given ? spp : 0;
+            DeadlineStats st = render_deadline(acc, resolved, default_thread_pool(), cfg, shade);
+            std::clog << "Deadline: " << st.elapsed_ms << " of " << st.budget_ms << " ms, " << st.passes << " full passes, " << st.samples << " samples ("
+                      << st.min_spp << "-" << st.max_spp << " spp, " << st.mean_spp << " on average), coverage " << 100.0 * st.coverage << "%\n";
+        }
+        else if (adaptive) {
+            AdaptiveSettings cfg;
+            cfg.min_spp = std::min(cfg.min_spp, spp);
+            cfg.max_spp = spp;
+            cfg.threshold = adaptive_error;
+            cfg.budget = sample_budget;
+            AdaptiveStats st = render_adaptive(acc, default_thread_pool(), cfg, shade);
+            std::clog << "Adaptive: " << st.samples << " samples, " << st.mean_spp << " spp on average (tiles " << st.min_tile_spp << "-" << st.max_tile_spp
+                      << " spp), " << st.converged_tiles << "/" << st.tiles << " tiles converged in " << st.rounds << " rounds\n";
+        }
+        else {
+            render_progressive(acc, default_thread_pool(), spp, shade);
+        }
 
-            // color pixel_color  ->  Declare variable 'pixel_color' of type 'color' (same as 'vec3') that holds RGB values for one pixel; this is set equal to ray_color(r), which computes the color for the ray going through this pixel, i.e., vec3/color
-            color pixel_color = ray_color(r);       // based on the ray direction, find out what color the pixel is emitting (black if no object)
-            // write_color(std::cout, pixel_color); // prints pixel RGB values on screen
+        if (deadline_ms <= 0.0) acc.resolve(resolved, default_thread_pool());     // render_deadline resolves within its budget
+        std::copy(resolved.pixels.begin(), resolved.pixels.end(), image.begin());
+    }
+    else {
+        // In the float build (main_float) the ray directions of a whole row come from the SIMD ray generation kernel picked at startup
+        // (C_cpu_dispatch.h), as SoA: direction of pixel (i, j) = (pixel00_loc - camera_center) + i * pixel_delta_u + j * pixel_delta_v
+        // The kernel works in float, so the double build keeps computing pixel center minus camera center in vec3 instead of rounding every direction
+        constexpr bool simd_ray_dirs = std::is_same_v<real, float>;
+        const vec3 pixel00_dir = pixel00_loc - camera_center;
+        const RayGenParams cam = {
+            { float(pixel00_dir.x()), float(pixel00_dir.y()), float(pixel00_dir.z()) },
+            { float(pixel_delta_u.x()), float(pixel_delta_u.y()), float(pixel_delta_u.z()) },
+            { float(pixel_delta_v.x()), float(pixel_delta_v.y()), float(pixel_delta_v.z()) },
+        };
+        std::vector<float> dir_x(simd_ray_dirs ? image_width : 0), dir_y(dir_x.size()), dir_z(dir_x.size());
+        for (int j = 0; j < image_height; j++) {
+            std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
+            if (simd_ray_dirs) cpu_kernels().generate_ray_dirs(cam, j, 0, image_width, dir_x.data(), dir_y.data(), dir_z.data());
+            for (int i = 0; i < image_width; i++) {
+                vec3 ray_direction;     // ray direction from camera to the (i,j)-th pixel's center, but not unit vector for code simplicity
+                if (simd_ray_dirs) ray_direction = vec3(dir_x[i], dir_y[i], dir_z[i]);
+                else {
+                    auto pixel_center = pixel00_loc + (i * pixel_delta_u) + (j * pixel_delta_v);    // coordinates of each (i,j)-th pixel's center
+                    ray_direction = pixel_center - camera_center;
+                }
+                ray r(camera_center, ray_direction);    // a ray class object is defined by origin of the ray (camera_center), direction of the ray (ray_direction) and a function at(t) to get a point along the ray (origin + t*direction) <- half ray if positive!
+
+                // color pixel_color  ->  Declare variable 'pixel_color' of type 'color' (same as 'vec3') that holds RGB values for one pixel; this is set equal to ray_color(r), which computes the color for the ray going through this pixel, i.e., vec3/color
+                color pixel_color = ray_color(r, world);       // based on the ray direction, find out what color the pixel is emitting (black if no object)
+                // write_color(std::cout, pixel_color); // prints pixel RGB values on screen
             
-            // Scale RGB values back to [0,255] from [0.0-1.0] to write into file
-            int ir = static_cast<int>(255.999 * pixel_color.x());
-            int ig = static_cast<int>(255.999 * pixel_color.y());
-            int ib = static_cast<int>(255.999 * pixel_color.z());
-
-            int index = (j * image_width + i) * 3;
-            image[index + 0] = static_cast<unsigned char>(ir);
-            image[index + 1] = static_cast<unsigned char>(ig);
-            image[index + 2] = static_cast<unsigned char>(ib);
+                // Scale RGB values back to [0,255] from [0.0-1.0] to write into file
+                int ir = static_cast<int>(255.999 * pixel_color.x());
+                int ig = static_cast<int>(255.999 * pixel_color.y());
+                int ib = static_cast<int>(255.999 * pixel_color.z());
+
+                int index = (j * image_width + i) * 3;
+                image[index + 0] = static_cast<unsigned char>(ir);
+                image[index + 1] = static_cast<unsigned char>(ig);
+                image[index + 2] = static_cast<unsigned char>(ib);
+            }
         }
     }
 
@@ -0,0 +1,117 @@
+// C_accum_buffer.h
+#pragma once
+#include <cstdint>      // uint32_t sample counters
+#include <vector>
+#include <atomic>       // cancellation flag checked between tiles
+#include <algorithm>    // std::min, std::fill
+#include "C_image.h"
+#include "C_cpu_dispatch.h"    // quantize_rgb8
+#include "C_thread_pool.h"
+#include "C_tile_scheduler.h"
+
+// Progressive Rendering
+// Image only holds final 8-bit colors, so once a pixel is written its precision is gone and more samples cannot be added to it
+// AccumBuffer keeps a running float (HDR, not clamped to [0,1]) sum of every sample per pixel plus the number of samples taken
+    // the displayed color is sum / count, computed on demand by resolve(), so the render can be previewed, continued with more samples, or stopped at any time
+    // counts are per pixel, so a pass interrupted halfway is still correct: finished pixels have one more sample than the rest
+// Passes are split into tiles (C_tile_scheduler.h); every tile is owned by exactly one worker during a pass, so accumulation needs no locks or atomics per pixel
+
+struct AccumBuffer {
+    int width, height;
+    std::vector<float> sum;             // width * height * 3 running RGB sums, same interleaved layout as Image::pixels
+    std::vector<uint32_t> samples;      // width * height sample counts
+
+    AccumBuffer(int w, int h) : width(w), height(h), sum(size_t(w) * h * 3, 0.0f), samples(size_t(w) * h, 0) {}
+
+    void clear() {
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        std::fill(samples.begin(), samples.end(), 0u);
+    }
+
+    inline size_t index(int x, int y) const { return size_t(y) * width + x; }
+
+    inline void add_sample(int x, int y, const float* rgb) {
+        size_t i = index(x, y);
+        sum[3 * i + 0] += rgb[0];
+        sum[3 * i + 1] += rgb[1];
+        sum[3 * i + 2] += rgb[2];
+        samples[i] += 1;
+    }
+
+    uint64_t total_samples() const {
+        uint64_t n = 0;
+        for (uint32_t s : samples) n += s;
+        return n;
+    }
+
+    // Average rows [y0, y1) into img; pixels with no samples yet come out black
+    void resolve_rows(Image& img, int y0, int y1) const {
+        float buf[3 * kQuantizeChunk];
+        for (int y = y0; y < y1; ++y) {
+            for (int x0 = 0; x0 < width; x0 += kQuantizeChunk) {
+                int n = std::min(kQuantizeChunk, width - x0);
+                for (int k = 0; k < n; ++k) {
+                    size_t i = index(x0 + k, y);
+                    float inv = samples[i] ? 1.0f / float(samples[i]) : 0.0f;
+                    buf[3 * k + 0] = sum[3 * i + 0] * inv;
+                    buf[3 * k + 1] = sum[3 * i + 1] * inv;
+                    buf[3 * k + 2] = sum[3 * i + 2] * inv;
+                }
+                quantize_rgb8(buf, img.pixel_ptr(x0, y), size_t(3) * n);
+            }
+        }
+    }
+
+    void resolve(Image& img) const { resolve_rows(img, 0, height); }
+
+    // Resolve on the pool's workers, one row at a time from a shared counter like render_cpu_threads
+    void resolve(Image& img, ThreadPool& pool) const {
+        std::atomic<int> next_row{ 0 };
+        pool.run([&](int) {
+            int y;
+            while ((y = next_row.fetch_add(1, std::memory_order_relaxed)) < height) resolve_rows(img, y, y + 1);
+            });
+    }
+};
+
+// Add one sample to every pixel of tile t; shade(x, y, sample_index, rgb) writes the sample's float color into rgb[0..2]
+// sample_index is the pixel's own count before this sample, so it does not depend on which worker renders the tile or when
+template <typename Shade>
+inline void accumulate_tile(AccumBuffer& acc, const Tile& t, Shade& shade) {
+    float rgb[3];
+    for (int y = t.y0; y < t.y1; ++y)
+        for (int x = t.x0; x < t.x1; ++x) {
+            shade(x, y, acc.samples[acc.index(x, y)], rgb);
+            acc.add_sample(x, y, rgb);
+        }
+}
+
+// Progressive render: 'passes' passes of one sample per pixel, each pass split into tiles and work-stolen across the pool
+// After every pass, on_pass(pass_index) runs on the calling thread (e.g. resolve and save a preview); returning false stops early
+// Setting *cancel from any thread stops the render after the tiles currently in progress; everything accumulated so far is kept
+template <typename Shade, typename OnPass>
+inline int render_progressive(AccumBuffer& acc, ThreadPool& pool, int passes, Shade shade, OnPass on_pass,
+                              const std::atomic<bool>* cancel = nullptr, int tile_w = 32, int tile_h = 32) {
+    const std::vector<Tile> tiles = make_tiles(acc.width, acc.height, tile_w, tile_h);
+    int done = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) break;
+        TileScheduler sched(int(tiles.size()), pool.size());
+        pool.run([&](int w) {
+            int t;
+            while (sched.next(w, t)) {
+                if (cancel && cancel->load(std::memory_order_relaxed)) return;
+                accumulate_tile(acc, tiles[t], shade);
+            }
+            });
+        ++done;
+        if (!on_pass(pass)) break;
+    }
+    return done;    // passes started; the last one may be partial if cancelled
+}
+
+// Same without a per-pass callback
+template <typename Shade>
+inline int render_progressive(AccumBuffer& acc, ThreadPool& pool, int passes, Shade shade, const std::atomic<bool>* cancel = nullptr) {
+    return render_progressive(acc, pool, passes, shade, [](int) { return true; }, cancel);
+}
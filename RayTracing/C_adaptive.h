@@ -0,0 +1,147 @@
+// C_adaptive.h
+#pragma once
+#include <cstdint>
+#include <cmath>        // std::sqrt
+#include <vector>
+#include <atomic>
+#include <algorithm>    // std::sort, std::min, std::max
+#include "C_accum_buffer.h"
+#include "C_thread_pool.h"
+#include "C_tile_scheduler.h"
+
+// Progressive Rendering
+// A fixed sample count spends as much on a flat patch of sky as on a noisy edge or a soft shadow, and most frames are mostly sky
+// Adaptive sampling keeps a running mean and variance per pixel (Welford's update, numerically stable in float) and stops sampling where the estimate has converged:
+    // every pixel first gets min_spp samples, so the variance estimate means something
+    // then, in rounds, each tile's error is the worst relative standard error of its pixels, sqrt(var / n) / max(mean, floor), on luminance
+    // tiles above the threshold get batch_spp more samples per pixel; tiles below it (or at max_spp) are done
+// The target is an error threshold, a total sample budget, or both (whichever stops first); with a budget, the noisiest tiles are served first in each round
+// Decisions are per tile rather than per pixel: a single pixel's variance after a few samples is itself noisy, and a pixel that looks flat by chance would stop too early
+// Everything is decided on the calling thread from data that does not depend on scheduling, and shade() gets each pixel's own sample index (like accumulate_tile),
+// so the result is identical for any number of threads
+
+struct AdaptiveSettings {
+    int min_spp = 16;               // samples every pixel gets before any error is measured
+    int max_spp = 1024;             // cap per pixel
+    int batch_spp = 16;             // samples added to an unconverged tile per round
+    float threshold = 0.01f;        // target relative standard error; 0 = no threshold (run until the budget or max_spp)
+    uint64_t budget = 0;            // total samples for the frame; 0 = no budget
+    float luminance_floor = 0.05f;  // denominator floor, so near-black pixels are not chased to max_spp
+    int tile_w = 16, tile_h = 16;
+};
+
+struct AdaptiveStats {
+    uint64_t samples = 0;           // total samples taken
+    int rounds = 0;                 // adaptive rounds after the warm-up pass
+    int tiles = 0;
+    int converged_tiles = 0;        // tiles that met the threshold (the rest hit max_spp or the budget)
+    int min_tile_spp = 0, max_tile_spp = 0;
+    double mean_spp = 0.0;
+};
+
+// Per-pixel running mean and M2 (sum of squared deviations) of luminance
+struct VarianceBuffer {
+    std::vector<float> mean, m2;
+
+    VarianceBuffer(int w, int h) : mean(size_t(w) * h, 0.0f), m2(size_t(w) * h, 0.0f) {}
+
+    // n = number of samples including this one
+    inline void add(size_t i, float value, uint32_t n) {
+        const float delta = value - mean[i];
+        mean[i] += delta / float(n);
+        m2[i] += delta * (value - mean[i]);
+    }
+
+    // Relative standard error of the mean after n samples
+    inline float relative_error(size_t i, uint32_t n, float floor) const {
+        if (n < 2) return INFINITY;
+        const float var = m2[i] / float(n - 1);
+        return std::sqrt(var / float(n)) / std::max(mean[i], floor);
+    }
+};
+
+inline float luminance(const float* rgb) { return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2]; }
+
+// Add 'count' samples to every pixel of tile t, updating the sums and the variance, and return the tile's error (worst pixel)
+template <typename Shade>
+inline float accumulate_tile_adaptive(AccumBuffer& acc, VarianceBuffer& var, const Tile& t, int count, float floor, Shade& shade) {
+    float rgb[3];
+    float worst = 0.0f;
+    for (int y = t.y0; y < t.y1; ++y)
+        for (int x = t.x0; x < t.x1; ++x) {
+            const size_t i = acc.index(x, y);
+            for (int s = 0; s < count; ++s) {
+                shade(x, y, acc.samples[i], rgb);
+                acc.add_sample(x, y, rgb);
+                var.add(i, luminance(rgb), acc.samples[i]);
+            }
+            worst = std::max(worst, var.relative_error(i, acc.samples[i], floor));
+        }
+    return worst;
+}
+
+// Adaptive render into acc (expected empty); shade(x, y, sample_index, rgb) as for render_progressive
+template <typename Shade>
+inline AdaptiveStats render_adaptive(AccumBuffer& acc, ThreadPool& pool, const AdaptiveSettings& cfg, Shade shade) {
+    const std::vector<Tile> tiles = make_tiles(acc.width, acc.height, cfg.tile_w, cfg.tile_h);
+    const int num_tiles = int(tiles.size());
+    const int max_spp = std::max(1, cfg.max_spp);
+    const int batch = std::max(1, cfg.batch_spp);
+    VarianceBuffer var(acc.width, acc.height);
+    std::vector<float> error(num_tiles, INFINITY);
+    std::vector<int> spp(num_tiles, 0);
+
+    AdaptiveStats stats;
+    stats.tiles = num_tiles;
+    auto tile_pixels = [&](int t) { return uint64_t(tiles[t].x1 - tiles[t].x0) * uint64_t(tiles[t].y1 - tiles[t].y0); };
+
+    // One round: jobs[k] = (tile, samples per pixel), claimed from a shared counter in the given order
+    std::vector<std::pair<int, int>> jobs;
+    auto run_jobs = [&]() {
+        std::atomic<int> next{ 0 };
+        pool.run([&](int) {
+            int k;
+            while ((k = next.fetch_add(1, std::memory_order_relaxed)) < int(jobs.size())) {
+                const int t = jobs[k].first;
+                error[t] = accumulate_tile_adaptive(acc, var, tiles[t], jobs[k].second, cfg.luminance_floor, shade);
+                spp[t] += jobs[k].second;
+            }
+            });
+        for (const auto& j : jobs) stats.samples += tile_pixels(j.first) * uint64_t(j.second);
+    };
+
+    // Warm-up, clipped to the budget if it cannot even cover that
+    int warm = std::min(std::max(1, cfg.min_spp), max_spp);
+    const uint64_t pixels = uint64_t(acc.width) * uint64_t(acc.height);
+    if (cfg.budget && pixels * uint64_t(warm) > cfg.budget) warm = int(std::max<uint64_t>(1, cfg.budget / std::max<uint64_t>(1, pixels)));
+    for (int t = 0; t < num_tiles; ++t) jobs.push_back({ t, warm });
+    run_jobs();
+
+    std::vector<int> order;
+    for (;;) {
+        order.clear();
+        for (int t = 0; t < num_tiles; ++t)
+            if (spp[t] < max_spp && !(cfg.threshold > 0.0f && error[t] <= cfg.threshold)) order.push_back(t);
+        if (order.empty()) break;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return error[a] > error[b]; });    // noisiest first
+
+        jobs.clear();
+        uint64_t remaining = cfg.budget ? (cfg.budget > stats.samples ? cfg.budget - stats.samples : 0) : UINT64_MAX;
+        for (int t : order) {
+            int n = std::min(batch, max_spp - spp[t]);
+            if (cfg.budget) n = int(std::min<uint64_t>(uint64_t(n), remaining / tile_pixels(t)));
+            if (n <= 0) continue;
+            jobs.push_back({ t, n });
+            if (cfg.budget) remaining -= tile_pixels(t) * uint64_t(n);
+        }
+        if (jobs.empty()) break;    // budget spent
+        run_jobs();
+        ++stats.rounds;
+    }
+
+    stats.min_tile_spp = num_tiles ? *std::min_element(spp.begin(), spp.end()) : 0;
+    stats.max_tile_spp = num_tiles ? *std::max_element(spp.begin(), spp.end()) : 0;
+    for (int t = 0; t < num_tiles; ++t) if (cfg.threshold > 0.0f && error[t] <= cfg.threshold) ++stats.converged_tiles;
+    stats.mean_spp = pixels ? double(stats.samples) / double(pixels) : 0.0;
+    return stats;
+}
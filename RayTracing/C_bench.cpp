@@ -0,0 +1,137 @@
+// C_bench.cpp
+// Benchmark runner for the CPU rendering backends: warmup + repeated timed runs, summary statistics and JSON output
+// Usage: bench [--warmup N] [--reps N] [--res WxH]... [--backend NAME[:key=value,...]]... [--json PATH] [--perf] [--list] [--simd LEVEL] [--bvh PRIMS]
+    // defaults: 2 warmup runs, 20 timed runs, the four resolutions from the notes in C_main.cu, every registered backend (C_renderer.h) with default options
+    // the same backend can be given more than once with different options, e.g. --backend tiles:tile=16 --backend tiles:tile=128
+    // --simd scalar|sse2|avx2|avx512 (or RT_SIMD=...) runs the dispatched kernels at that level instead of the best one (C_cpu_dispatch.h)
+    // --perf (or RT_PERF=1) adds one untimed run per backend under hardware performance counters (C_perf_counters.h)
+    // --bvh N benchmarks the BVH builders over N particle spheres instead of the render backends, then refit on an animated cloud and instancing (C_bench_bvh.h)
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>       // std::sscanf
+#include <cstdlib>      // std::atoi
+#include <memory>
+
+#include "C_image.h"
+#include "C_bench.h"
+#include "C_render_cpu_baseline.h"
+#include "C_renderer.h"
+#include "C_thread_pool.h"
+#include "C_cpu_dispatch.h"
+#include "C_bench_bvh.h"
+#include "C_bench_kernels.h"
+
+struct Resolution {
+    int w, h;
+};
+
+int main(int argc, char** argv) {
+    int warmup = 2, reps = 20;
+    std::string json_path;
+    std::vector<Resolution> resolutions;
+    std::vector<std::string> selected;
+    bool perf = perf_counters_requested();
+    int bvh_prims = 0;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--warmup" && has_value) warmup = std::atoi(argv[++a]);
+        else if (arg == "--reps" && has_value) reps = std::atoi(argv[++a]);
+        else if (arg == "--json" && has_value) json_path = argv[++a];
+        else if (arg == "--backend" && has_value) selected.push_back(argv[++a]);
+        else if (arg == "--perf") perf = true;
+        else if (arg == "--bvh" && has_value) bvh_prims = std::atoi(argv[++a]);
+        else if (arg == "--simd" && has_value) {
+            SimdLevel level;
+            if (!simd_level_from_name(argv[++a], level)) {
+                std::cerr << "bad --simd value, expected scalar, sse2, avx2 or avx512\n";
+                return 1;
+            }
+            set_simd_level(level);
+        }
+        else if (arg == "--list") {
+            print_renderers(std::cout);
+            return 0;
+        }
+        else if (arg == "--res" && has_value) {
+            Resolution r{};
+            if (std::sscanf(argv[++a], "%dx%d", &r.w, &r.h) != 2 || r.w <= 0 || r.h <= 0) {
+                std::cerr << "bad --res value, expected WxH\n";
+                return 1;
+            }
+            resolutions.push_back(r);
+        }
+        else {
+            std::cerr << "usage: bench [--warmup N] [--reps N] [--res WxH]... [--backend NAME[:key=value,...]]... [--json PATH] [--perf] [--list] [--simd LEVEL] [--bvh PRIMS]\n";
+            return 1;
+        }
+    }
+    if (reps < 1) reps = 1;
+    if (warmup < 0) warmup = 0;
+    if (resolutions.empty()) resolutions = { {1200, 600}, {1920, 1080}, {3840, 2160}, {7680, 4320} };   // same sizes as the notes in C_main.cu
+
+    std::cout << "SIMD kernels: " << simd_level_name(active_simd_level()) << " (cpu supports " << simd_level_name(cpu_simd_level()) << ")\n";
+    default_thread_pool();      // created here so thread start-up is not charged to the first pooled run
+    if (check_simd_kernels(std::cerr) > 0) return 2;   // every level must match scalar before any of them is worth timing
+    if (bvh_prims > 0) return run_bvh_bench(std::cout, bvh_prims, warmup, reps, default_thread_pool());
+
+    // Renderers are created once (pools and other per-backend state are set up outside the timed runs) and reused for every resolution
+    // Every backend renders the same gradient, so each one is checked against the baseline output once per resolution
+    if (selected.empty())
+        for (const RendererInfo* info : RendererRegistry::instance().list()) selected.push_back(info->name);
+    std::vector<std::pair<std::string, std::unique_ptr<Renderer>>> backends;
+    for (const std::string& spec : selected) {
+        std::string err;
+        std::unique_ptr<Renderer> r = RendererRegistry::instance().create(spec, &err);
+        if (!r) {
+            std::cerr << err << "\navailable backends:\n";
+            print_renderers(std::cerr);
+            return 1;
+        }
+        backends.emplace_back(spec, std::move(r));
+    }
+
+    std::vector<BenchStats> results;
+    for (const Resolution& res : resolutions) {
+        Image reference(res.w, res.h);
+        render_cpu_baseline(reference);
+
+        for (auto& [spec, renderer] : backends) {
+            Image img(res.w, res.h);    // allocated once per backend, so page faults of a fresh buffer land in the warmup runs
+            BenchStats st;
+            st.backend = spec;
+            st.width = res.w;
+            st.height = res.h;
+            st.warmup = warmup;
+            st.reps = reps;
+            st.samples_ms = time_runs([&]() { renderer->render(img); }, warmup, reps);
+            st.matches_reference = (img.pixels == reference.pixels);
+            summarize(st);
+            if (perf) {     // separate run, so opening and reading counters never lands in the timed samples
+                PerfProfiler profiler(renderer->thread_pool(), true);
+                st.perf = profiler.measure([&]() { renderer->render(img); });
+                st.has_perf = true;
+            }
+
+            print_stats(std::cout, st);
+            results.push_back(st);
+        }
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        if (!out) {
+            std::cerr << "cannot open " << json_path << "\n";
+            return 1;
+        }
+        write_json(out, results, warmup, reps);
+        std::cout << "Wrote " << json_path << "\n";
+    }
+
+    for (const BenchStats& st : results)
+        if (!st.matches_reference) return 2;    // non-zero exit so scripts notice a backend that renders the wrong image
+    return 0;
+}
@@ -0,0 +1,141 @@
+// C_bench.h
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>    // std::sort
+#include <cmath>        // std::sqrt
+#include <ostream>
+#include "C_timer.h"
+#include "C_perf_counters.h"
+
+// Benchmarking
+// Replaces the single tic/toc per backend in C_main.cu with repeated measurements and summary statistics
+// One trial is noise: caches, turbo clocks, page faults on the first touch of a fresh buffer and OS scheduling can all move a single run by 10% or more
+// Warmup runs are discarded, then 'reps' timed runs are summarized by median and percentiles (robust to outliers) plus mean/stddev
+
+struct BenchStats {
+    std::string backend;
+    int width = 0, height = 0;
+    int warmup = 0, reps = 0;
+    double min_ms = 0, max_ms = 0, mean_ms = 0, stddev_ms = 0;
+    double median_ms = 0, p5_ms = 0, p95_ms = 0;
+    double mpix_per_s = 0;          // million pixels per second at the median time
+    bool matches_reference = true;  // output identical to the baseline renderer
+    std::vector<double> samples_ms; // every timed run, in order
+    bool has_perf = false;          // hardware counters were requested (--perf) for one extra, untimed run
+    PerfReport perf;
+};
+
+// Percentile of sorted samples with linear interpolation between the two closest ranks (q in [0,1])
+inline double percentile_sorted(const std::vector<double>& s, double q) {
+    if (s.empty()) return 0.0;
+    double pos = q * double(s.size() - 1);
+    size_t lo = size_t(pos);
+    size_t hi = std::min(lo + 1, s.size() - 1);
+    double frac = pos - double(lo);
+    return s[lo] + (s[hi] - s[lo]) * frac;
+}
+
+// Fill the summary fields of st from st.samples_ms
+inline void summarize(BenchStats& st) {
+    std::vector<double> s = st.samples_ms;
+    if (s.empty()) return;
+    std::sort(s.begin(), s.end());
+
+    double sum = 0;
+    for (double v : s) sum += v;
+    st.mean_ms = sum / double(s.size());
+    double var = 0;
+    for (double v : s) var += (v - st.mean_ms) * (v - st.mean_ms);
+    st.stddev_ms = s.size() > 1 ? std::sqrt(var / double(s.size() - 1)) : 0.0;    // sample standard deviation
+
+    st.min_ms = s.front();
+    st.max_ms = s.back();
+    st.median_ms = percentile_sorted(s, 0.50);
+    st.p5_ms = percentile_sorted(s, 0.05);
+    st.p95_ms = percentile_sorted(s, 0.95);
+    st.mpix_per_s = st.median_ms > 0 ? (double(st.width) * st.height) / (st.median_ms * 1e3) : 0.0;   // pixels per ms / 1000 = Mpix per s
+}
+
+// Call fn() 'warmup' times untimed, then 'reps' times timed; fn renders one frame
+template <typename F>
+inline std::vector<double> time_runs(F&& fn, int warmup, int reps) {
+    for (int i = 0; i < warmup; ++i) fn();
+    std::vector<double> samples;
+    samples.reserve(reps);
+    Timer t;
+    for (int i = 0; i < reps; ++i) {
+        t.tic();
+        fn();
+        samples.push_back(t.toc_ms());
+    }
+    return samples;
+}
+
+// Human-readable one-line summary
+inline void print_stats(std::ostream& out, const BenchStats& st) {
+    out << st.backend << " " << st.width << "x" << st.height
+        << "  median " << st.median_ms << " ms"
+        << "  p5 " << st.p5_ms << "  p95 " << st.p95_ms
+        << "  stddev " << st.stddev_ms
+        << "  " << st.mpix_per_s << " Mpix/s"
+        << (st.matches_reference ? "" : "  [OUTPUT MISMATCH]") << "\n";
+    if (st.has_perf) print_perf(out, st.backend.c_str(), st.perf);
+}
+
+// s as a quoted JSON string: quotes and backslashes are escaped and control characters written as \u00XX, so any --backend spec gives valid JSON
+inline void write_json_string(std::ostream& out, const std::string& s) {
+    static const char hex[] = "0123456789abcdef";
+    out << '"';
+    for (char ch : s) {
+        const unsigned char c = (unsigned char)ch;
+        if (c == '"' || c == '\\') out << '\\' << ch;
+        else if (c < 0x20) out << "\\u00" << hex[c >> 4] << hex[c & 15];
+        else out << ch;
+    }
+    out << '"';
+}
+
+// {"cycles": 123, ..., "ipc": 1.5}; events that could not be counted are null
+inline void write_perf_json(std::ostream& out, const PerfCounts& c) {
+    out << "{";
+    for (int e = 0; e < kPerfEventCount; ++e) {
+        out << (e ? ", " : "") << "\"" << perf_event_name(e) << "\": ";
+        if (c.valid[e]) out << c.value[e];
+        else out << "null";
+    }
+    out << ", \"ipc\": ";
+    if (c.valid[kPerfCycles] && c.valid[kPerfInstructions]) out << c.ipc();
+    else out << "null";
+    out << "}";
+}
+
+// Machine-readable results: one JSON object with the run settings and an array of per-(backend, resolution) results
+inline void write_json(std::ostream& out, const std::vector<BenchStats>& results, int warmup, int reps) {
+    out << "{\n  \"warmup\": " << warmup << ",\n  \"reps\": " << reps << ",\n  \"results\": [\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const BenchStats& st = results[k];
+        out << "    {\"backend\": ";
+        write_json_string(out, st.backend);
+        out << ", \"width\": " << st.width << ", \"height\": " << st.height
+            << ", \"median_ms\": " << st.median_ms << ", \"mean_ms\": " << st.mean_ms << ", \"stddev_ms\": " << st.stddev_ms
+            << ", \"p5_ms\": " << st.p5_ms << ", \"p95_ms\": " << st.p95_ms
+            << ", \"min_ms\": " << st.min_ms << ", \"max_ms\": " << st.max_ms
+            << ", \"mpix_per_s\": " << st.mpix_per_s
+            << ", \"matches_reference\": " << (st.matches_reference ? "true" : "false");
+        if (st.has_perf) {
+            out << ", \"perf\": ";
+            write_perf_json(out, st.perf.total);
+            out << ", \"perf_per_worker\": [";
+            for (size_t w = 0; w < st.perf.per_worker.size(); ++w) {
+                out << (w ? ", " : "");
+                write_perf_json(out, st.perf.per_worker[w]);
+            }
+            out << "]";
+        }
+        out << ", \"samples_ms\": [";
+        for (size_t i = 0; i < st.samples_ms.size(); ++i) out << (i ? ", " : "") << st.samples_ms[i];
+        out << "]}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
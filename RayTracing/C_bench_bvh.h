@@ -0,0 +1,355 @@
+// C_bench_bvh.h
+#pragma once
+#include <vector>
+#include <string>
+#include <ostream>
+#include <functional>
+#include <memory>       // std::unique_ptr for the LBVH builders
+#include <limits>
+#include <algorithm>    // std::sort to match the animated spheres to the scene, std::max
+#include <cmath>        // std::abs
+#include "C_bench.h"
+#include "C_rng.h"
+#include "C_thread_pool.h"
+#include "bvh.h"
+#include "bvh_lbvh.h"
+#include "bvh_wide.h"
+#include "bvh_compressed.h"
+#include "bvh_refit.h"
+#include "bvh_instance.h"
+
+// Benchmarking
+// bench --bvh N: build and trace acceleration structures over a synthetic particle cloud of N spheres instead of rendering the gradient
+// Every builder is timed over the same warmup/reps as the render backends (median and p95 build time), then checked against the SAH tree
+// with random rays and axis-aligned rays with signed-zero components: any ray whose closest hit differs is a traversal or build bug, and makes bench exit with 2 like a mismatched image
+// Particles are sized and placed with the counter-based RNG (C_rng.h), so the scene is the same on every run and machine
+
+// N spheres with radii in [0.05, 0.35] in a 100 x 100 x 10 slab (a particle layer: dense, flat and uneven, which is hard on Morton codes)
+inline std::vector<sphere> make_particle_scene(int count, uint64_t seed = 1) {
+    const RngKey key = make_rng_key(seed);
+    std::vector<sphere> scene;
+    scene.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        uint32_t u[4];
+        for (uint32_t d = 0; d < 4; ++d) u[d] = rng_u32(key, uint32_t(i), 0, 0, d);
+        const point3 center(100.0 * rng_u01(u[0]), 100.0 * rng_u01(u[1]), 10.0 * rng_u01(u[2]));
+        scene.emplace_back(center, 0.05 + 0.3 * rng_u01(u[3]));
+    }
+    return scene;
+}
+
+// Rays from above the slab toward random points below it
+inline std::vector<ray> make_particle_rays(int count, uint64_t seed = 2) {
+    const RngKey key = make_rng_key(seed);
+    std::vector<ray> rays;
+    rays.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        uint32_t u[4];
+        for (uint32_t d = 0; d < 4; ++d) u[d] = rng_u32(key, uint32_t(i), 0, 0, d);
+        const point3 origin(100.0 * rng_u01(u[0]), 100.0 * rng_u01(u[1]), 60.0);
+        const point3 target(100.0 * rng_u01(u[2]), 100.0 * rng_u01(u[3]), -10.0);
+        rays.emplace_back(origin, target - origin);
+    }
+    return rays;
+}
+
+// Axis-aligned rays whose other direction components are -0.0 or +0.0: straight down onto the slab and level through it along x and y
+// Random rays never have a zero component, but a -0.0 one has an inverse of -inf, which a slab test that reads the sign with d < 0 gets wrong
+inline std::vector<ray> make_signed_zero_rays(int count, uint64_t seed = 3) {
+    const RngKey key = make_rng_key(seed);
+    std::vector<ray> rays;
+    rays.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        uint32_t u[2];
+        for (uint32_t d = 0; d < 2; ++d) u[d] = rng_u32(key, uint32_t(i), 0, 0, d);
+        const double a = 100.0 * rng_u01(u[0]), b = rng_u01(u[1]);
+        const double z0 = (i & 4) ? -0.0 : 0.0, z1 = (i & 8) ? -0.0 : 0.0;     // both signs of zero, in every combination
+        switch (i & 3) {
+        case 0: rays.emplace_back(point3(a, 100.0 * b, 60.0), vec3(z0, z1, -1.0)); break;
+        case 1: rays.emplace_back(point3(-10.0, a, 10.0 * b), vec3(1.0, z0, z1)); break;
+        case 2: rays.emplace_back(point3(110.0, a, 10.0 * b), vec3(-1.0, z0, z1)); break;
+        default: rays.emplace_back(point3(a, -10.0, 10.0 * b), vec3(z0, 1.0, z1)); break;
+        }
+    }
+    return rays;
+}
+
+// One acceleration structure under test: build() (re)builds it, hit() traces one ray and returns the closest t (or -1), describe() gives its size and quality
+struct BvhBenchCase {
+    std::string name;
+    std::function<void()> build;
+    std::function<double(const ray&)> hit;
+    std::function<std::string()> describe;
+};
+
+// Closest-hit t for a ray against any hittable, -1 on a miss
+inline double closest_t(const hittable& h, const ray& r) {
+    hit_record rec;
+    return h.hit(r, real(0.001), std::numeric_limits<real>::infinity(), rec) ? double(rec.t) : -1.0;
+}
+
+inline std::string describe_bvh(const bvh& tree) {
+    const bvh_stats st = tree.stats();
+    return "nodes " + std::to_string(st.node_count) + "  depth " + std::to_string(st.max_depth) + "  SAH " + std::to_string(st.sah_cost) +
+        "  " + std::to_string(tree.nodes.size() * sizeof(bvh_node) / 1024) + " KiB";
+}
+
+template <int W>
+inline std::string describe_bvh_wide(const bvh_wide<W>& tree) {
+    const bvh_wide_stats st = tree.stats();
+    return "nodes " + std::to_string(st.node_count) + "  depth " + std::to_string(st.max_depth) + "  children/node " + std::to_string(st.mean_children) +
+        "  " + std::to_string(st.bytes / 1024) + " KiB";
+}
+
+inline std::string describe_bvh_compressed(const bvh_compressed& tree, const bvh& binary) {
+    const bvh_compressed_stats st = tree.stats(binary);
+    return "nodes " + std::to_string(st.node_count) + "  " + std::to_string(st.bytes / 1024) + " KiB (binary " + std::to_string(st.binary_bytes / 1024) +
+        ")  SAH " + std::to_string(st.sah_cost) + " (binary " + std::to_string(st.binary_sah_cost) + ")  area x" + std::to_string(st.mean_area_growth);
+}
+
+// Animated particles for the refit bench: the whole cloud drifts rigidly, and the particles in one 20 x 20 corner of the slab also fly apart
+// from its center, so most subtrees keep their quality and only the ones over that corner degrade
+inline sphere animated_particle(const sphere& rest, int frame) {
+    const point3 blast(10.0, 10.0, 5.0);
+    vec3 motion = frame * vec3(1.0, 0.5, 0.0);
+    const vec3 away = rest.center - blast;
+    if (std::abs(away.x()) < 10.0 && std::abs(away.y()) < 10.0) motion += (0.15 * frame) * away;
+    return sphere(rest.center + motion, rest.radius);
+}
+
+// Frames of the animation above: refit + selective rebuild per frame against a full SAH rebuild, then the final tree is checked against a fresh one.
+// Returns 0, or 2 on a hit mismatch
+inline int run_bvh_refit_bench(std::ostream& out, const std::vector<sphere>& scene, const std::vector<ray>& rays, int frames, ThreadPool& pool) {
+    bvh tree(scene);
+    std::vector<int> ids(tree.spheres.size());      // scene index of every sphere in the tree's leaf order
+    {
+        // The SAH build reordered the spheres; recover which is which by matching each to its rest position
+        std::vector<sphere> sorted = tree.spheres;
+        std::vector<int> order(scene.size());
+        for (int i = 0; i < int(order.size()); ++i) order[i] = i;
+        auto less = [](const sphere& a, const sphere& b) {
+            for (int k = 0; k < 3; ++k)
+                if (a.center[k] != b.center[k]) return a.center[k] < b.center[k];
+            return a.radius < b.radius;
+        };
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return less(scene[a], scene[b]); });
+        std::vector<int> leaf(tree.spheres.size());
+        for (int k = 0; k < int(leaf.size()); ++k) leaf[k] = k;
+        std::sort(leaf.begin(), leaf.end(), [&](int a, int b) { return less(tree.spheres[a], tree.spheres[b]); });
+        for (int k = 0; k < int(leaf.size()); ++k) ids[leaf[k]] = order[k];
+    }
+
+    bvh_refitter refitter(pool);
+    refitter.reset(tree.nodes);
+    std::vector<sphere> moved(scene.size());
+    std::vector<int> perm, reordered;
+    out << "animation: " << frames << " frames, refit + selective rebuild vs full SAH rebuild\n";
+    for (int f = 1; f <= frames; ++f) {
+        for (int k = 0; k < int(ids.size()); ++k) tree.spheres[k] = animated_particle(scene[ids[k]], f);
+        const bvh_refit_stats st = refit_bvh(tree, refitter, &perm);
+        if (st.rebuilt_subtrees > 0) {
+            reordered.resize(ids.size());
+            for (int k = 0; k < int(ids.size()); ++k) reordered[k] = ids[perm[k]];
+            ids.swap(reordered);
+        }
+
+        for (int i = 0; i < int(scene.size()); ++i) moved[i] = animated_particle(scene[i], f);
+        Timer t;
+        t.tic();
+        const bvh fresh(moved);
+        const double full_ms = t.toc_ms();
+        out << "  frame " << f << "  refit " << st.refit_ms << " ms  rebuild " << st.rebuild_ms << " ms (" << st.rebuilt_subtrees << " subtrees, "
+            << st.rebuilt_prims << " spheres)  growth " << st.root_growth << "  SAH " << st.sah_cost << "  |  full SAH build " << full_ms
+            << " ms  SAH " << fresh.stats().sah_cost << "\n";
+
+        if (f == frames) {
+            int mismatches = 0;
+            for (const ray& r : rays)
+                if (closest_t(tree, r) != closest_t(fresh, r)) ++mismatches;
+            if (mismatches) {
+                out << "  [" << mismatches << " HIT MISMATCHES after refit]\n";
+                return 2;
+            }
+        }
+    }
+    return 0;
+}
+
+// Instanced forest: prims / 250 copies of 4 assets of 250 spheres each (a 4 x 4 x 8 blob standing on the origin), each copy moved onto the slab,
+// tilted about y and scaled uniformly, traced through a two-level structure and through one flattened bvh of the same spheres.
+// Uniform scales keep the flattened spheres spheres; the two-level structure does not need that. Returns 0, or 2 on a hit mismatch
+inline int run_instance_bench(std::ostream& out, int prims, const std::vector<ray>& rays, int warmup, int reps) {
+    constexpr int kAssets = 4, kAssetSpheres = 250;
+    std::vector<std::shared_ptr<const bvh>> assets;
+    for (int a = 0; a < kAssets; ++a) {
+        const RngKey key = make_rng_key(10 + a);
+        std::vector<sphere> blob;
+        for (int i = 0; i < kAssetSpheres; ++i) {
+            uint32_t u[4];
+            for (uint32_t d = 0; d < 4; ++d) u[d] = rng_u32(key, uint32_t(i), 0, 0, d);
+            blob.emplace_back(point3(4.0 * rng_u01(u[0]) - 2.0, 4.0 * rng_u01(u[1]) - 2.0, 8.0 * rng_u01(u[2])), 0.1 + 0.3 * rng_u01(u[3]));
+        }
+        assets.push_back(std::make_shared<const bvh>(blob));
+    }
+
+    const int copies = std::max(1, prims / kAssetSpheres);
+    const RngKey key = make_rng_key(20);
+    std::vector<instance> instances;
+    std::vector<sphere> flattened;
+    instances.reserve(copies);
+    flattened.reserve(size_t(copies) * kAssetSpheres);
+    for (int c = 0; c < copies; ++c) {
+        uint32_t u[5];
+        for (uint32_t d = 0; d < 5; ++d) u[d] = rng_u32(key, uint32_t(c), 0, 0, d);
+        const double scale = 0.5 + rng_u01(u[3]);
+        const affine3 xf = affine3::translation(vec3(100.0 * rng_u01(u[0]), 100.0 * rng_u01(u[1]), 0.0)) *
+            affine3::rotation_y(0.6 * rng_u01(u[2]) - 0.3) * affine3::scaling(vec3(scale, scale, scale));
+        const std::shared_ptr<const bvh>& asset = assets[u[4] % kAssets];
+        instances.emplace_back(asset, xf);
+        for (const sphere& sp : asset->spheres) flattened.emplace_back(xf.point(sp.center), real(scale) * sp.radius);
+    }
+
+    bvh_tlas tlas;
+    bvh flat;
+    BenchStats tlas_build, flat_build;
+    tlas_build.samples_ms = time_runs([&]() { tlas = bvh_tlas(instances); }, warmup, reps);
+    flat_build.samples_ms = time_runs([&]() { flat = bvh(flattened); }, warmup, reps);
+    summarize(tlas_build);
+    summarize(flat_build);
+    const bvh_tlas_stats st = tlas.stats();
+
+    auto trace = [&](const hittable& h, std::vector<double>& t_hit) {
+        t_hit.resize(rays.size());
+        Timer t;
+        t.tic();
+        for (size_t i = 0; i < rays.size(); ++i) t_hit[i] = closest_t(h, rays[i]);
+        return rays.size() / (t.toc_ms() * 1e3);
+    };
+    std::vector<double> t_tlas, t_flat;
+    const double tlas_mrays = trace(tlas, t_tlas), flat_mrays = trace(flat, t_flat);
+
+    // The top level must find exactly what testing every instance finds (same arithmetic, so compared exactly; first 10k rays, it is a linear scan)
+    int mismatches = 0;
+    for (size_t i = 0; i < std::min<size_t>(rays.size(), 10000); ++i) {
+        hit_record rec;
+        real t_max = std::numeric_limits<real>::infinity();
+        bool hit = false;
+        for (const instance& inst : instances)
+            if (inst.hit(rays[i], real(0.001), t_max, rec)) {
+                t_max = rec.t;
+                hit = true;
+            }
+        if ((hit ? double(t_max) : -1.0) != t_tlas[i]) ++mismatches;
+    }
+
+    // Against the flattened spheres: object-space rays round differently, and the sphere quadratic can lose half the digits of t, so hits
+    // are compared with a relative tolerance of sqrt(epsilon). In a float build a small sphere far from the origin can even be missed by one
+    // side only, so there the differences are reported but only fail a double build
+    const double tolerance = std::sqrt(double(std::numeric_limits<real>::epsilon()));
+    int differing = 0;
+    for (size_t i = 0; i < rays.size(); ++i)
+        if ((t_tlas[i] < 0) != (t_flat[i] < 0) || std::abs(t_tlas[i] - t_flat[i]) > tolerance * std::max(1.0, std::abs(t_flat[i]))) ++differing;
+    if constexpr (sizeof(real) == sizeof(double)) mismatches += differing;
+
+    out << "instancing: " << st.instance_count << " instances of " << st.blas_count << " assets, " << st.sphere_count << " spheres\n"
+        << "  two-level  build median " << tlas_build.median_ms << " ms  top nodes " << st.top.node_count << "  " << st.bytes / 1024 << " KiB"
+        << "  trace " << tlas_mrays << " Mrays/s\n"
+        << "  flattened  build median " << flat_build.median_ms << " ms  nodes " << flat.nodes.size() << "  " << bvh_memory_bytes(flat) / 1024 << " KiB"
+        << "  trace " << flat_mrays << " Mrays/s  (" << differing << " hits differ from two-level)"
+        << (mismatches ? "  [" + std::to_string(mismatches) + " HIT MISMATCHES]" : std::string()) << "\n";
+    return mismatches ? 2 : 0;
+}
+
+// Returns the process exit code: 0, or 2 if any structure disagreed with the SAH reference on some ray
+inline int run_bvh_bench(std::ostream& out, int prims, int warmup, int reps, ThreadPool& pool) {
+    const std::vector<sphere> scene = make_particle_scene(prims);
+    std::vector<ray> rays = make_particle_rays(100000);
+    const std::vector<ray> zero_rays = make_signed_zero_rays(1000);
+    rays.insert(rays.end(), zero_rays.begin(), zero_rays.end());
+    std::vector<aabb> boxes;
+    boxes.reserve(scene.size());
+    for (const sphere& s : scene) boxes.push_back(s.bounding_box());
+    out << "BVH: " << prims << " spheres, " << rays.size() << " rays, " << pool.size() << " threads\n";
+
+    bvh reference(scene);
+    std::vector<double> expected(rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) expected[i] = closest_t(reference, rays[i]);
+
+    std::vector<BvhBenchCase> cases;
+    bvh sah_tree;
+    cases.push_back({ "sah",
+        [&]() { sah_tree = bvh(scene); },
+        [&](const ray& r) { return closest_t(sah_tree, r); },
+        [&]() { return describe_bvh(sah_tree); } });
+
+    // Wide BVHs collapsed from the SAH tree (the "sah" case has built it by the time these run); build time = collapse only
+    bvh4 wide4;
+    bvh8 wide8;
+    cases.push_back({ "sah>bvh4",
+        [&]() { wide4 = bvh4(sah_tree); },
+        [&](const ray& r) { return closest_t(wide4, r); },
+        [&]() { return describe_bvh_wide(wide4); } });
+    cases.push_back({ "sah>bvh8",
+        [&]() { wide8 = bvh8(sah_tree); },
+        [&](const ray& r) { return closest_t(wide8, r); },
+        [&]() { return describe_bvh_wide(wide8); } });
+
+    // 16-byte quantized nodes of the same tree: memory against traversal cost of the looser boxes
+    bvh_compressed quantized;
+    cases.push_back({ "sah>qbvh",
+        [&]() { quantized = bvh_compressed(sah_tree); },
+        [&](const ray& r) { return closest_t(quantized, r); },
+        [&]() { return describe_bvh_compressed(quantized, sah_tree); } });
+
+    // LBVH variants keep their builder (and its buffers) across runs, like a per-frame rebuild would
+    struct LbvhVariant {
+        std::string name;
+        lbvh_build_options options;
+    };
+    std::vector<LbvhVariant> variants = { { "lbvh30", {} }, { "lbvh63", {} }, { "lbvh30+treelets", {} } };
+    variants[1].options.morton_bits = 63;
+    variants[2].options.treelet_passes = 2;
+    std::vector<std::unique_ptr<lbvh_builder>> builders;
+    std::vector<bvh> lbvh_trees(variants.size());
+    std::vector<lbvh_build_timings> lbvh_timings(variants.size());
+    for (size_t v = 0; v < variants.size(); ++v) {
+        builders.push_back(std::make_unique<lbvh_builder>(pool, variants[v].options));
+        cases.push_back({ variants[v].name,
+            [&, v]() {
+                std::vector<int> order;
+                builders[v]->build(boxes, lbvh_trees[v].nodes, order, &lbvh_timings[v]);
+                lbvh_trees[v].spheres.resize(scene.size());
+                for (size_t k = 0; k < order.size(); ++k) lbvh_trees[v].spheres[k] = scene[order[k]];
+            },
+            [&, v](const ray& r) { return closest_t(lbvh_trees[v], r); },
+            [&, v]() { return describe_bvh(lbvh_trees[v]); } });
+    }
+
+    int exit_code = 0;
+    for (BvhBenchCase& c : cases) {
+        BenchStats st;
+        st.backend = c.name;
+        st.samples_ms = time_runs(c.build, warmup, reps);
+        summarize(st);
+
+        Timer t;
+        t.tic();
+        int mismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i)
+            if (c.hit(rays[i]) != expected[i]) ++mismatches;
+        const double trace_ms = t.toc_ms();
+
+        out << c.name << "  build median " << st.median_ms << " ms  p95 " << st.p95_ms << "  " << c.describe()
+            << "  trace " << (rays.size() / (trace_ms * 1e3)) << " Mrays/s"
+            << (mismatches ? "  [" + std::to_string(mismatches) + " HIT MISMATCHES]" : std::string()) << "\n";
+        if (mismatches) exit_code = 2;
+    }
+    for (size_t v = 0; v < variants.size(); ++v) {
+        const lbvh_build_timings& tm = lbvh_timings[v];
+        out << "  " << variants[v].name << " last build: morton " << tm.morton_ms << "  sort " << tm.sort_ms << "  hierarchy " << tm.hierarchy_ms
+            << "  bounds " << tm.bounds_ms << "  treelets " << tm.treelet_ms << "  output " << tm.output_ms << " ms\n";
+    }
+    if (run_bvh_refit_bench(out, scene, rays, 8, pool)) exit_code = 2;
+    if (run_instance_bench(out, prims, rays, warmup, reps)) exit_code = 2;
+    return exit_code;
+}
@@ -0,0 +1,105 @@
+// C_bench_kernels.h
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>      // std::memcmp
+#include <limits>
+#include <ostream>
+#include <algorithm>    // std::min
+#include "C_cpu_dispatch.h"
+#include "vec3_packet.h"
+
+// Benchmarking
+// Every SIMD level must give the same bytes as the scalar reference (C_cpu_dispatch.h promises bit-identical kernels), so bench checks each level
+// the CPU supports against scalar before timing anything, on inputs the renders never produce: NaN, infinities, huge and negative values
+// Checked: quantize_rgb8 and generate_ray_dirs (main's primary rays), the latter also against the same directions computed with vec3_packet
+// A level that disagrees makes bench exit with 2, like a backend that renders the wrong image
+
+// Channel values around and outside [0,1], repeated with different offsets so every vector width sees each of them in its vector body and its scalar tail
+inline std::vector<float> quantize_check_input() {
+    const float special[] = {
+        0.0f, -0.0f, 0.5f, 0.999f, 1.0f, 1.0001f, 2.0f, -1.0f, 1e9f, -1e9f, 8.4e6f, 3.4e38f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::denorm_min(),
+    };
+    std::vector<float> in;
+    for (int rep = 0; rep < 13; ++rep)      // 13 * 16 = 208 values: not a multiple of 16, 32 or 64, so each kernel also runs its tail
+        for (int k = 0; k < 16; ++k) in.push_back(special[(k + rep) % 16]);
+    for (int k = 0; k < 300; ++k) in.push_back(float(k) / 256.0f);
+    return in;
+}
+
+// Cameras for the ray generation check: main's (400x225, viewport 2 high at z = -1) and one with large, negative and tiny components
+inline std::vector<RayGenParams> ray_gen_check_cameras() {
+    return {
+        { { -1.7733f, 0.9911f, -1.0f }, { 0.0088889f, 0.0f, 0.0f }, { 0.0f, -0.0088889f, 0.0f } },
+        { { 1e6f, -3.5f, 1e-7f }, { -0.125f, 1e-3f, 7.0f }, { 2.5e-5f, 1e4f, -0.3f } },
+    };
+}
+
+// The same directions written with the portable SoA types of vec3_packet.h, 8 pixels per packet, in the scalar kernel's order of operations
+// (row start = base + j * dv, then row start + i * du), so they must match it bit for bit like the hand-written kernels
+inline void generate_ray_dirs_packet(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz) {
+    using P = packet<float, 8>;
+    const float fj = float(j);
+    const vec3x8f row(P(cam.base[0] + fj * cam.dv[0]), P(cam.base[1] + fj * cam.dv[1]), P(cam.base[2] + fj * cam.dv[2]));
+    const vec3x8f du(P(cam.du[0]), P(cam.du[1]), P(cam.du[2]));
+    for (int k = 0; k < n; k += 8) {
+        P fi;
+        for (int l = 0; l < 8; ++l) fi[l] = float(i0 + k + l);
+        const vec3x8f d = row + fi * du;
+        for (int l = 0; l < std::min(8, n - k); ++l) {
+            dx[k + l] = d.x[l];
+            dy[k + l] = d.y[l];
+            dz[k + l] = d.z[l];
+        }
+    }
+}
+
+// Returns the number of kernels, summed over levels, that disagreed with scalar
+inline int check_simd_kernels(std::ostream& out) {
+    int failures = 0;
+    const std::vector<float> q_in = quantize_check_input();
+    std::vector<uint8_t> q_ref(q_in.size()), q_out(q_in.size());
+    quantize_rgb8_scalar(q_in.data(), q_ref.data(), q_in.size());
+
+    // Ray directions: a whole row (211 pixels, so every width also runs its tail), starting at 0 and at an odd column, for a few rows
+    const std::vector<RayGenParams> cams = ray_gen_check_cameras();
+    const int rg_n = 211, rg_rows[] = { 0, 1, 224, -3 }, rg_starts[] = { 0, 13 };
+    auto ray_dirs = [&](RayGenFn fn) {
+        std::vector<float> all;
+        std::vector<float> dx(rg_n), dy(rg_n), dz(rg_n);
+        for (const RayGenParams& cam : cams)
+            for (int j : rg_rows)
+                for (int i0 : rg_starts) {
+                    fn(cam, j, i0, rg_n, dx.data(), dy.data(), dz.data());
+                    all.insert(all.end(), dx.begin(), dx.end());
+                    all.insert(all.end(), dy.begin(), dy.end());
+                    all.insert(all.end(), dz.begin(), dz.end());
+                }
+        return all;
+        };
+    const std::vector<float> rg_ref = ray_dirs(generate_ray_dirs_scalar);
+    if (std::memcmp(ray_dirs(generate_ray_dirs_packet).data(), rg_ref.data(), rg_ref.size() * sizeof(float)) != 0) {
+        out << "SIMD check: vec3_packet ray directions differ from scalar\n";
+        ++failures;
+    }
+
+    const SimdLevel levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    for (SimdLevel level : levels) {
+        if (int(level) > int(cpu_simd_level())) continue;
+        const CpuKernels k = cpu_kernels_for(level);
+        if (k.level != level) continue;         // no kernels for this level in this build
+
+        k.quantize_rgb8(q_in.data(), q_out.data(), q_in.size());
+        if (std::memcmp(q_out.data(), q_ref.data(), q_ref.size()) != 0) {
+            out << "SIMD check: " << simd_level_name(level) << " quantize_rgb8 differs from scalar\n";
+            ++failures;
+        }
+        if (std::memcmp(ray_dirs(k.generate_ray_dirs).data(), rg_ref.data(), rg_ref.size() * sizeof(float)) != 0) {
+            out << "SIMD check: " << simd_level_name(level) << " generate_ray_dirs differs from scalar\n";
+            ++failures;
+        }
+    }
+    return failures;
+}
@@ -0,0 +1,108 @@
+// C_cpu_dispatch.h
+#pragma once
+#include <atomic>
+#include <cstdlib>      // std::getenv for the RT_SIMD override
+#include <cstring>      // std::strcmp
+#include "C_cpu_features.h"
+#include "C_quantize.h"
+#include "C_simd_kernels.h"
+#include "C_rng.h"
+#include "C_sobol.h"
+
+// SIMD Optimization
+// One binary for a mixed fleet: the build has no -march/-mavx2 flags, every hot kernel is compiled for each instruction set (C_quantize.h, C_simd_kernels.h),
+// and this table of function pointers is filled once at startup for the best level cpuid reports (C_cpu_features.h)
+// Callers go through cpu_kernels().<kernel>, an indirect call per row chunk (hundreds of pixels), so the dispatch cost does not show up
+// Override, for benchmarking one level against another on the same machine:
+    // environment: RT_SIMD=scalar|sse2|avx2|avx512 (read once, on first use)
+    // code:        set_simd_level(SimdLevel::AVX2), e.g. from bench --simd avx2
+// Requests above what the CPU supports are lowered to the detected level, so an override can never select an illegal instruction
+
+struct CpuKernels {
+    SimdLevel level;
+    GradientSpanFn gradient_span;       // pixel generation
+    QuantizeFn quantize_rgb8;           // float RGB -> bytes
+    RayGenFn generate_ray_dirs;         // camera ray directions for a run of pixels
+    RngSpanFn rng_span;                 // Philox random words for a run of pixels (C_rng.h)
+    OwenSobolSpanFn owen_sobol_span;    // one Sobol' point, Owen-scrambled per pixel for a run of pixels (C_sobol.h)
+};
+
+// Table for one level; levels this build or architecture has no kernels for fall back to scalar
+inline CpuKernels cpu_kernels_for(SimdLevel level) {
+    CpuKernels k{ SimdLevel::Scalar, gradient_span_scalar, quantize_rgb8_scalar, generate_ray_dirs_scalar, rng_span_scalar, owen_sobol_span_scalar };
+#ifdef RT_X86
+    switch (level) {
+    case SimdLevel::AVX512:
+        k = { SimdLevel::AVX512, gradient_span_avx512, quantize_rgb8_avx512, generate_ray_dirs_avx512, rng_span_avx512, owen_sobol_span_avx512 };
+        break;
+    case SimdLevel::AVX2:
+        k = { SimdLevel::AVX2, gradient_span_avx2, quantize_rgb8_avx2, generate_ray_dirs_avx2, rng_span_avx2, owen_sobol_span_avx2 };
+        break;
+    case SimdLevel::SSE2:
+        k = { SimdLevel::SSE2, gradient_span_sse2, quantize_rgb8_sse2, generate_ray_dirs_sse2, rng_span_sse2, owen_sobol_span_scalar };   // no 32-bit mullo before SSE4.1
+        break;
+    default: break;
+    }
+#else
+    (void)level;
+#endif
+    return k;
+}
+
+// "scalar", "sse2", "avx2", "avx512" -> level; returns false for anything else
+inline bool simd_level_from_name(const char* name, SimdLevel& out) {
+    const SimdLevel all[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+    for (SimdLevel s : all)
+        if (name && std::strcmp(name, simd_level_name(s)) == 0) { out = s; return true; }
+    return false;
+}
+
+namespace cpu_dispatch_detail {
+
+inline SimdLevel clamp_to_cpu(SimdLevel requested) {
+    return int(requested) > int(cpu_simd_level()) ? cpu_simd_level() : requested;
+}
+
+// Detected level, lowered by RT_SIMD if it is set to a known name
+inline SimdLevel startup_level() {
+    SimdLevel level = cpu_simd_level();
+    SimdLevel requested;
+    if (simd_level_from_name(std::getenv("RT_SIMD"), requested)) level = clamp_to_cpu(requested);
+    return level;
+}
+
+inline std::atomic<int>& active_level() {
+    static std::atomic<int> level{ int(startup_level()) };
+    return level;
+}
+
+}   // namespace cpu_dispatch_detail
+
+// Kernels for the active level; the four tables are built once and never change, switching levels only swaps which one is returned
+inline const CpuKernels& cpu_kernels() {
+    static const CpuKernels tables[4] = {
+        cpu_kernels_for(SimdLevel::Scalar), cpu_kernels_for(SimdLevel::SSE2),
+        cpu_kernels_for(SimdLevel::AVX2), cpu_kernels_for(SimdLevel::AVX512),
+    };
+    return tables[cpu_dispatch_detail::active_level().load(std::memory_order_relaxed)];
+}
+
+inline SimdLevel active_simd_level() { return cpu_kernels().level; }
+
+// Select a level at runtime (clamped to what the CPU supports); returns the level actually in use
+// Meant for benchmarks and tests between renders, not while other threads are inside a kernel call
+inline SimdLevel set_simd_level(SimdLevel level) {
+    SimdLevel used = cpu_dispatch_detail::clamp_to_cpu(level);
+    cpu_dispatch_detail::active_level().store(int(used), std::memory_order_relaxed);
+    return cpu_kernels().level;
+}
+
+// Uniform floats in [0, 1) for pixels (x0 .. x0+n-1, y) at one sample and dimension, with the active kernel; same values as PixelRng / rng_u32 on every level
+inline void rng_uniform_span(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, float* out) {
+    rng_uniform_span(cpu_kernels().rng_span, key, x0, y, n, sample, dim, out);
+}
+
+// Convert n floats (n/3 RGB pixels) to n bytes with the active kernel
+inline void quantize_rgb8(const float* in, uint8_t* out, size_t n) {
+    cpu_kernels().quantize_rgb8(in, out, n);
+}
@@ -0,0 +1,86 @@
+// C_cpu_features.h
+#pragma once
+
+// SIMD Optimization
+// Detects at runtime which x86 vector instruction sets the CPU (and OS) supports, so one binary can pick SSE2, AVX2 or AVX-512 code paths
+// The build uses no -mavx2 / /arch flags; the fast kernels are compiled with per-function target attributes (RT_TARGET_*) and only called after this check says they are safe
+
+#if defined(__x86_64__) || defined(_M_X64)     // 64-bit x86 only, where SSE2 is always available
+#define RT_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>     // __cpuid, __cpuidex, _xgetbv
+#else
+#include <cpuid.h>      // __get_cpuid_count
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic; GCC/Clang need the instruction set enabled on the function that uses it
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RT_TARGET_AVX2
+#define RT_TARGET_AVX512
+#else
+#define RT_TARGET_AVX2 __attribute__((target("avx2")))
+#define RT_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// Ordered from slowest to fastest, so "level >= SimdLevel::AVX2" means "AVX2 or better"
+enum class SimdLevel { Scalar = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+inline const char* simd_level_name(SimdLevel s) {
+    switch (s) {
+    case SimdLevel::SSE2: return "sse2";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// Ask the CPU with the cpuid instruction; AVX also needs the OS to save the wide registers on context switches, which xgetbv reports
+inline SimdLevel detect_simd_level() {
+#ifdef RT_X86
+    unsigned int r1[4] = { 0, 0, 0, 0 }, r7[4] = { 0, 0, 0, 0 };     // eax, ebx, ecx, edx of cpuid leaf 1 and leaf 7
+#if defined(_MSC_VER) && !defined(__clang__)
+    int t[4];
+    __cpuid(t, 0);
+    int max_leaf = t[0];
+    __cpuid(t, 1);
+    for (int k = 0; k < 4; ++k) r1[k] = unsigned(t[k]);
+    if (max_leaf >= 7) {
+        __cpuidex(t, 7, 0);
+        for (int k = 0; k < 4; ++k) r7[k] = unsigned(t[k]);
+    }
+#else
+    __get_cpuid_count(1, 0, &r1[0], &r1[1], &r1[2], &r1[3]);
+    __get_cpuid_count(7, 0, &r7[0], &r7[1], &r7[2], &r7[3]);    // returns 0 and leaves r7 zeroed if leaf 7 does not exist
+#endif
+    bool sse2 = (r1[3] >> 26) & 1;
+    bool osxsave = (r1[2] >> 27) & 1;
+    if (!sse2) return SimdLevel::Scalar;
+    if (!osxsave) return SimdLevel::SSE2;
+
+    unsigned long long xcr0;
+#if defined(_MSC_VER) && !defined(__clang__)
+    xcr0 = _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    xcr0 = (unsigned long long)hi << 32 | lo;
+#endif
+    bool os_avx = (xcr0 & 0x6) == 0x6;          // XMM and YMM state enabled
+    bool os_avx512 = (xcr0 & 0xE6) == 0xE6;     // plus opmask and ZMM state
+
+    bool avx2 = (r7[1] >> 5) & 1;
+    bool avx512f = (r7[1] >> 16) & 1;
+    if (avx512f && os_avx512) return SimdLevel::AVX512;
+    if (avx2 && os_avx) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;                   // not x86: only the portable scalar paths are available
+#endif
+}
+
+// Detected once per process and cached
+inline SimdLevel cpu_simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
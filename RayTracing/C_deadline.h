@@ -0,0 +1,156 @@
+// C_deadline.h
+#pragma once
+#include <cstdint>
+#include <climits>      // UINT32_MAX
+#include <vector>
+#include <atomic>
+#include <algorithm>    // std::stable_sort, std::min, std::max
+#include "C_timer.h"
+#include "C_image.h"
+#include "C_accum_buffer.h"
+#include "C_thread_pool.h"
+#include "C_tile_scheduler.h"
+
+// Progressive Rendering
+// An interactive request has a latency target, not a sample count: "the best image you can make in 50 ms" rather than "64 spp, however long that takes"
+// render_deadline() runs progressive passes (one sample per pixel per pass, like render_progressive) on the ThreadPool and stops handing out tiles
+// when the next one would not finish in time, then resolves what it has:
+    // a Timer started at the call is the only clock; the budget covers rendering and the final resolve, whose cost is measured on a few rows up front and kept back
+    // every worker times its tiles, and a tile is only claimed if elapsed + safety * (mean tile time) still fits the render budget,
+    // so the stop decision adapts to the scene and the machine instead of relying on a fixed sample count
+    // tiles are visited center-out in every pass, so a pass cut short has refined the middle of the frame, where the viewer looks, and not the top rows
+// A pass that was cut short leaves some tiles one sample ahead of the rest, which AccumBuffer handles (counts are per pixel)
+// If even the first pass does not fit, the pixels it did not reach come out black; coverage in the stats says how much of the frame has at least one sample
+
+struct DeadlineSettings {
+    double budget_ms = 33.0;        // wall-clock budget for the whole call, from entry to the resolved image
+    double reserve_ms = -1.0;       // part of the budget kept for the resolve and stats at the end; < 0 = estimate it from a timed resolve of a few rows
+    double safety = 1.5;            // a tile is started only if elapsed + safety * mean tile time fits; > 1 leaves room for tiles slower than average
+    int max_passes = 0;             // stop after this many passes even with time left; 0 = no limit
+    int tile_w = 32, tile_h = 32;
+};
+
+struct DeadlineStats {
+    double budget_ms = 0;
+    double elapsed_ms = 0;          // render + resolve, as seen by the caller
+    double render_ms = 0;
+    double reserve_ms = 0;          // budget kept back for the resolve
+    double tile_ms = 0;             // mean time of one tile on one worker
+    int passes = 0;                 // complete passes
+    uint64_t tiles = 0;             // tiles rendered over all passes
+    uint64_t samples = 0;
+    double coverage = 0;            // fraction of pixels with at least one sample
+    uint32_t min_spp = 0, max_spp = 0;
+    double mean_spp = 0;
+
+    bool met() const { return elapsed_ms <= budget_ms; }
+};
+
+// Tiles ordered by the distance of their center from the image center
+inline std::vector<Tile> make_tiles_center_out(int width, int height, int tile_w, int tile_h) {
+    std::vector<Tile> tiles = make_tiles(width, height, tile_w, tile_h);
+    auto dist2 = [&](const Tile& t) {
+        const int64_t dx = int64_t(t.x0 + t.x1) - width, dy = int64_t(t.y0 + t.y1) - height;     // 2 * (tile center - image center)
+        return dx * dx + dy * dy;
+        };
+    std::stable_sort(tiles.begin(), tiles.end(), [&](const Tile& a, const Tile& b) { return dist2(a) < dist2(b); });
+    return tiles;
+}
+
+// Render into acc (usually empty, but a buffer from an earlier call keeps refining) until the deadline, then resolve into img (same size)
+// shade(x, y, sample_index, rgb) as for render_progressive
+template <typename Shade>
+inline DeadlineStats render_deadline(AccumBuffer& acc, Image& img, ThreadPool& pool, const DeadlineSettings& cfg, Shade shade) {
+    Timer clock;
+    clock.tic();
+
+    DeadlineStats stats;
+    stats.budget_ms = cfg.budget_ms;
+    double reserve_ms = cfg.reserve_ms;
+    if (reserve_ms < 0.0) {
+        // Resolve + count scan for a few rows (overwritten by the real resolve later), scaled to the frame and the pool
+        const int rows = std::min(acc.height, 16);
+        Timer t;
+        t.tic();
+        acc.resolve_rows(img, 0, rows);
+        uint64_t scan = 0;
+        for (size_t i = 0; i < size_t(rows) * acc.width; ++i) scan += acc.samples[i];
+        volatile uint64_t keep = scan;  // the scan is timed, so it must not be optimized away
+        (void)keep;
+        reserve_ms = rows ? cfg.safety * t.toc_ms() * (double(acc.height) / rows) / pool.size() : 0.0;
+    }
+    stats.reserve_ms = reserve_ms;
+    const double render_budget = cfg.budget_ms - reserve_ms;
+    const std::vector<Tile> tiles = make_tiles_center_out(acc.width, acc.height, cfg.tile_w, cfg.tile_h);
+    const int num_tiles = int(tiles.size());
+
+    // Tile timings from all workers: total nanoseconds and count
+    std::atomic<uint64_t> tile_ns{ 0 }, tile_count{ 0 };
+    auto mean_tile_ms = [&]() {
+        const uint64_t n = tile_count.load(std::memory_order_relaxed);
+        return n ? 1e-6 * double(tile_ns.load(std::memory_order_relaxed)) / double(n) : 0.0;
+        };
+    std::atomic<bool> out_of_time{ false };
+
+    while (num_tiles && !out_of_time.load() && (cfg.max_passes <= 0 || stats.passes < cfg.max_passes)) {
+        std::atomic<int> next{ 0 }, finished{ 0 };
+        pool.run([&](int) {
+            for (;;) {
+                // Before any tile has finished there is no estimate yet, and the first tiles always start
+                if (clock.toc_ms() + cfg.safety * mean_tile_ms() > render_budget) {
+                    out_of_time.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                const int k = next.fetch_add(1, std::memory_order_relaxed);
+                if (k >= num_tiles) return;
+                Timer t;
+                t.tic();
+                accumulate_tile(acc, tiles[k], shade);
+                tile_ns.fetch_add(uint64_t(t.toc_ms() * 1e6), std::memory_order_relaxed);
+                tile_count.fetch_add(1, std::memory_order_relaxed);
+                finished.fetch_add(1, std::memory_order_relaxed);
+            }
+            });
+        if (finished.load() == num_tiles) ++stats.passes;
+    }
+    stats.render_ms = clock.toc_ms();
+    stats.tile_ms = mean_tile_ms();
+    stats.tiles = tile_count.load();
+
+    // Resolve and sample statistics in one pass on the pool, a row at a time from a shared counter like AccumBuffer::resolve, paid from reserve_ms
+    // The reserve estimate scales the timed resolve + count scan by pool.size(), so both parts must run in parallel here
+    struct alignas(64) SppPartial {     // one per worker, on its own cache line
+        uint64_t samples = 0, covered = 0;
+        uint32_t min_spp = UINT32_MAX, max_spp = 0;
+    };
+    std::vector<SppPartial> partial(pool.size());
+    std::atomic<int> next_row{ 0 };
+    pool.run([&](int w) {
+        SppPartial& p = partial[w];
+        int y;
+        while ((y = next_row.fetch_add(1, std::memory_order_relaxed)) < acc.height) {
+            acc.resolve_rows(img, y, y + 1);
+            const uint32_t* row = acc.samples.data() + acc.index(0, y);
+            for (int x = 0; x < acc.width; ++x) {
+                const uint32_t s = row[x];
+                p.samples += s;
+                p.covered += s > 0;
+                p.min_spp = std::min(p.min_spp, s);
+                p.max_spp = std::max(p.max_spp, s);
+            }
+        }
+        });
+    uint64_t covered = 0;
+    stats.min_spp = acc.samples.empty() ? 0 : UINT32_MAX;
+    for (const SppPartial& p : partial) {
+        stats.samples += p.samples;
+        covered += p.covered;
+        stats.min_spp = std::min(stats.min_spp, p.min_spp);
+        stats.max_spp = std::max(stats.max_spp, p.max_spp);
+    }
+    const double pixels = double(acc.samples.size());
+    stats.coverage = pixels > 0 ? double(covered) / pixels : 0.0;
+    stats.mean_spp = pixels > 0 ? double(stats.samples) / pixels : 0.0;
+    stats.elapsed_ms = clock.toc_ms();
+    return stats;
+}
@@ -0,0 +1,196 @@
+// C_frame_pipeline.h
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>       // the output stage runs on its own thread
+#include <mutex>
+#include <condition_variable>   // frame hand-off between the stages (once per frame, so a lock is cheap here)
+#include <functional>
+#include <algorithm>    // std::max
+#include "C_image.h"
+#include "C_timer.h"
+#include "C_thread_pool.h"
+#include "C_ppm_writer.h"
+#include "C_jpeg_strips.h"
+
+// Parallel Programming + I/O
+// A sequence (turntable, animation) used to be a loop of render(frame); write(frame), so every frame cost render time + encode time and the render threads idled during every write
+// FramePipeline runs the two as stages on different threads with a fixed set of in-flight framebuffers:
+    // the calling thread renders frame N+1 into a free buffer (with whatever renderer and ThreadPool it already uses) while
+    // the output thread quantizes / encodes / writes frame N from another buffer, then hands the buffer back
+// With in_flight = 2 (double buffering) a sequence takes about max(render, output) per frame instead of the sum; more buffers absorb frames whose cost varies
+// The buffers are allocated once, so there is no per-frame allocation and memory is bounded by in_flight framebuffers
+// Frames are output strictly in order. The output stage must not use the renderer's ThreadPool: run() on a busy pool waits for the render to finish,
+// which would serialize the stages again; give it its own (small) pool if encoding should be parallel too (frame_output_file below)
+// Frame is the framebuffer type: Image for renderers that write bytes, or e.g. AccumBuffer (C_accum_buffer.h) when the output stage should also do the float -> 8-bit resolve
+
+// Per-sequence timings; render_ms/output_ms are summed over frames, wait_ms is how long the render stage waited for a free buffer (output is the bottleneck when it is large)
+struct FrameStats {
+    int frames = 0;
+    int failed = 0;             // frames whose output callback returned false
+    double total_ms = 0;
+    double render_ms = 0;
+    double output_ms = 0;
+    double wait_ms = 0;
+
+    double fps() const { return total_ms > 0 ? 1000.0 * frames / total_ms : 0.0; }
+    double serial_ms() const { return render_ms + output_ms; }     // what the old render-then-write loop would have taken
+};
+
+template <typename Frame>
+class FramePipeline {
+public:
+    using RenderFn = std::function<void(int frame, Frame& fb)>;
+    using OutputFn = std::function<bool(int frame, const Frame& fb)>;
+
+    // in_flight framebuffers of width x height, constructed as Frame(width, height)
+    FramePipeline(int width, int height, int in_flight = 2) {
+        in_flight = std::max(1, in_flight);
+        buffers_.reserve(in_flight);
+        for (int b = 0; b < in_flight; ++b) {
+            buffers_.emplace_back(width, height);
+            free_.push_back(b);
+        }
+    }
+
+    int in_flight() const { return int(buffers_.size()); }
+
+    // Render frames [first, first + count) on the calling thread and output them, in order, on a dedicated thread; returns after the last output finished
+    FrameStats run(int first, int count, const RenderFn& render, const OutputFn& output) {
+        FrameStats stats;
+        Timer total;
+        total.tic();
+        done_ = false;
+
+        std::thread out_thread([&]() {
+            for (;;) {
+                int frame, b;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    ready_cv_.wait(lock, [&]() { return !ready_.empty() || done_; });
+                    if (ready_.empty()) return;     // done_ and nothing left
+                    frame = ready_.front().first;
+                    b = ready_.front().second;
+                    ready_.pop_front();
+                }
+                Timer t;
+                t.tic();
+                bool ok = output(frame, buffers_[b]);
+                double ms = t.toc_ms();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stats.output_ms += ms;
+                    if (!ok) ++stats.failed;
+                    free_.push_back(b);
+                }
+                free_cv_.notify_one();
+            }
+            });
+
+        for (int f = first; f < first + count; ++f) {
+            Timer t;
+            t.tic();
+            int b;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                free_cv_.wait(lock, [&]() { return !free_.empty(); });
+                b = free_.front();
+                free_.pop_front();
+            }
+            stats.wait_ms += t.toc_ms();
+
+            t.tic();
+            render(f, buffers_[b]);
+            stats.render_ms += t.toc_ms();
+            ++stats.frames;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ready_.push_back({ f, b });
+            }
+            ready_cv_.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        ready_cv_.notify_one();
+        out_thread.join();
+        stats.total_ms = total.toc_ms();
+        return stats;
+    }
+
+private:
+    std::vector<Frame> buffers_;
+    std::deque<int> free_;                      // buffers the render stage may fill
+    std::deque<std::pair<int, int>> ready_;     // (frame, buffer) waiting for output, in frame order
+    std::mutex mutex_;
+    std::condition_variable free_cv_, ready_cv_;
+    bool done_ = false;
+};
+
+// A frame file name pattern split around its frame number: "out/frame_%04d.jpg" -> prefix "out/frame_", width 4, zero padded, suffix ".jpg"
+struct FramePattern {
+    std::string prefix, suffix;     // literal text, with "%%" already turned into '%'
+    int width = 0;
+    bool zero_pad = false;
+};
+
+// Parses a printf-style pattern by hand instead of handing user text (--out) to snprintf as a format string: it must contain exactly one
+// %d / %i conversion, optionally with a 0 flag and a width up to 32 (%04d, %6d), and every other '%' must be written "%%"
+// Returns false and sets err for anything else (no frame number, two of them, %s, %x, %-4d, ...)
+inline bool parse_frame_pattern(const std::string& pattern, FramePattern& out, std::string* err = nullptr) {
+    FramePattern fp;
+    bool found = false;
+    for (size_t k = 0; k < pattern.size(); ++k) {
+        std::string& text = found ? fp.suffix : fp.prefix;
+        if (pattern[k] != '%') { text += pattern[k]; continue; }
+        if (k + 1 < pattern.size() && pattern[k + 1] == '%') { text += '%'; ++k; continue; }
+
+        size_t e = k + 1;
+        const bool zero = e < pattern.size() && pattern[e] == '0';
+        if (zero) ++e;
+        int width = 0;
+        while (e < pattern.size() && pattern[e] >= '0' && pattern[e] <= '9' && width <= 32) width = 10 * width + (pattern[e++] - '0');
+        if (found || e >= pattern.size() || (pattern[e] != 'd' && pattern[e] != 'i') || width > 32) {
+            if (err) *err = found ? "frame pattern '" + pattern + "' has more than one conversion; write a literal % as %%"
+                                  : "frame pattern '" + pattern + "' has an unsupported conversion; use %d or %0Nd, and %% for a literal %";
+            return false;
+        }
+        fp.width = width;
+        fp.zero_pad = zero;
+        found = true;
+        k = e;
+    }
+    if (!found) {
+        if (err) *err = "frame pattern '" + pattern + "' has no frame number; add %d or %0Nd";
+        return false;
+    }
+    out = fp;
+    return true;
+}
+
+// "out/frame_%04d.jpg", 7 -> "out/frame_0007.jpg"; an invalid pattern (see parse_frame_pattern) gives ""
+inline std::string frame_path(const std::string& pattern, int frame) {
+    FramePattern fp;
+    if (!parse_frame_pattern(pattern, fp)) return "";
+    std::string digits = std::to_string(frame < 0 ? -(long long)frame : (long long)frame);
+    const std::string sign = frame < 0 ? "-" : "";
+    const size_t len = sign.size() + digits.size();
+    const size_t pad = size_t(fp.width) > len ? size_t(fp.width) - len : 0;
+    const std::string number = fp.zero_pad ? sign + std::string(pad, '0') + digits : std::string(pad, ' ') + sign + digits;
+    return fp.prefix + number + fp.suffix;
+}
+
+// Output stage for Image frames: write frame_path(pattern, frame) as .jpg (strip encoder on encode_pool, C_jpeg_strips.h) or as binary PPM otherwise
+// encode_pool must not be the pool the renderer runs on (see above); a ThreadPool(1) encodes on the output thread alone
+inline typename FramePipeline<Image>::OutputFn frame_output_file(const std::string& pattern, ThreadPool& encode_pool, int quality = 90) {
+    return [pattern, &encode_pool, quality](int frame, const Image& img) {
+        const std::string path = frame_path(pattern, frame);
+        if (path.empty()) return false;
+        const bool jpg = path.size() >= 4 && (path.compare(path.size() - 4, 4, ".jpg") == 0 || path.compare(path.size() - 4, 4, ".JPG") == 0);
+        return jpg ? write_jpg_strips(path, img, quality, encode_pool) : write_ppm(path, img, PpmFormat::P6);
+        };
+}
@@ -12,10 +12,10 @@ struct Image {
     int width, height;
     std::vector<uint8_t> pixels;    // pixels is a flat vector of size = width * height * 3 for RGB buffer
 
-    Image(int w, int h) : width(w), height(h), pixels(w* h * 3, 0) {}   // initialize dim and allocates w*h*3 bytes (3 channels) as 0's
+    Image(int w, int h) : width(w), height(h), pixels(size_t(w) * h * 3, 0) {}   // initialize dim and allocates w*h*3 bytes (3 channels) as 0's; size_t so w*h*3 past 2^31 does not overflow
 
     inline uint8_t* pixel_ptr(int x, int y) {   // return pointer to first byte of pixel (x,y)
-        return &pixels[3 * (y * width + x)];    // indexing for 2D image in 1D array: (2,1) = row 1, col 2 = 1*4 + 2 = 6; this does row * width + col, but 3 times for RGB
+        return &pixels[3 * (size_t(y) * width + x)];    // indexing for 2D image in 1D array: (2,1) = row 1, col 2 = 1*4 + 2 = 6; this does row * width + col, but 3 times for RGB (64-bit, since 3*y*width overflows int past ~26K x 26K)
     }
 
     // Simple PPM writer (portable, no deps)
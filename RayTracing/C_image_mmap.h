@@ -0,0 +1,221 @@
+// C_image_mmap.h
+#pragma once
+#include <cstdint>
+#include <cstdio>       // std::snprintf for the PPM header
+#include <cstring>      // std::memcpy
+#include <string>
+#include <atomic>       // per-tile dirty flags set from worker threads
+#include <memory>       // std::unique_ptr for the flag array
+#include <limits>
+#include <algorithm>    // std::min, std::max
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>    // CreateFileMapping, MapViewOfFile, FlushViewOfFile
+#else
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, msync, madvise
+#include <unistd.h>     // ftruncate, close, sysconf
+#endif
+
+// I/O Optimization
+// Image keeps every pixel in a std::vector, so a render has to fit in RAM: a 65536 x 65536 poster is 12 GB of RGB before anything is written out
+// MappedImage has the same shape (width, height, pixel_ptr(x, y)) but its pixels are a memory-mapped file, laid out as a finished binary PPM:
+    // create() writes the "P6\nW H\n255\n" header at the start of the file and sizes it to header + W*H*3 bytes, so when the render is done the file IS the output, no write pass
+    // the OS pages pixels in and out on demand, so resident memory is bounded by what the renderer touches, not by the image size
+    // indexing is 64-bit (size_t) throughout; the int math in the old Image::pixel_ptr overflowed past 2^31 bytes (~26K x 26K)
+// Dirty tracking is per tile (same grid and row-major order as make_tiles in C_tile_scheduler.h): renderers call mark_dirty(tile) when a tile is finished,
+// and flush_dirty() writes back only the pages those tiles cover, optionally dropping them from memory afterwards
+// render_cpu_tiles(MappedImage&, ...) in C_render_cpu_tiles.h renders one band of tiles at a time and flushes after each band, so memory stays at about one band
+
+class MappedImage {
+public:
+    int width = 0, height = 0;
+
+    MappedImage() = default;
+    ~MappedImage() { close(); }
+
+    MappedImage(const MappedImage&) = delete;
+    MappedImage& operator=(const MappedImage&) = delete;
+
+    // Create (or truncate) 'path' as a w x h PPM and map it read/write; dirty flags cover tile_w x tile_h tiles
+    // Pixel bytes start out as zero (the file is extended with ftruncate, so on most file systems it is sparse until written)
+    // Returns false if the file cannot be created, sized or mapped, e.g. not enough disk space or a 32-bit address space
+    bool create(const std::string& path, int w, int h, int tile_w = 64, int tile_h = 64) {
+        close();
+        if (w <= 0 || h <= 0) return false;
+
+        char header[64];
+        const int header_len = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", w, h);
+        const uint64_t total = uint64_t(header_len) + uint64_t(w) * uint64_t(h) * 3;
+        if (total > uint64_t(std::numeric_limits<size_t>::max())) return false;
+        if (!map_file(path, total)) return false;
+
+        std::memcpy(base_, header, size_t(header_len));
+        width = w;
+        height = h;
+        header_size_ = size_t(header_len);
+        pixels_ = base_ + header_size_;
+        tile_w_ = tile_w < 1 ? 1 : tile_w;
+        tile_h_ = tile_h < 1 ? 1 : tile_h;
+        tiles_x_ = (w + tile_w_ - 1) / tile_w_;
+        tiles_y_ = (h + tile_h_ - 1) / tile_h_;
+        dirty_.reset(new std::atomic<uint8_t>[size_t(tiles_x_) * tiles_y_]);
+        for (size_t t = 0; t < size_t(tiles_x_) * tiles_y_; ++t) dirty_[t].store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool is_open() const { return base_ != nullptr; }
+
+    inline uint8_t* pixel_ptr(int x, int y) {   // same contract as Image::pixel_ptr, 64-bit offset
+        return pixels_ + 3 * (size_t(y) * size_t(width) + size_t(x));
+    }
+
+    uint8_t* pixels() { return pixels_; }
+    size_t pixel_bytes() const { return size_t(width) * size_t(height) * 3; }
+    size_t file_size() const { return size_; }
+
+    // Dirty-tile grid
+    int tile_width() const { return tile_w_; }
+    int tile_height() const { return tile_h_; }
+    int tiles_x() const { return tiles_x_; }
+    int tiles_y() const { return tiles_y_; }
+    int tile_count() const { return tiles_x_ * tiles_y_; }
+    int tile_index(int x, int y) const { return (y / tile_h_) * tiles_x_ + x / tile_w_; }   // tile containing pixel (x, y)
+
+    // Record that a tile's pixels were written; safe to call from several threads
+    void mark_dirty(int tile) { dirty_[tile].store(1, std::memory_order_release); }
+    void mark_dirty(int x, int y) { mark_dirty(tile_index(x, y)); }
+
+    int dirty_count() const {
+        int n = 0;
+        for (int t = 0; t < tile_count(); ++t) n += dirty_[t].load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // Start writing back the pages of every dirty tile and clear their flags; returns the number of tiles flushed
+    // A tile's rows are not contiguous in the file, so its byte span runs from its first pixel to its last; spans of neighbouring dirty tiles are merged
+    // (tiles of one band overlap almost completely) so each band costs one msync instead of one per tile
+    // With release = true the flushed pages are also dropped from this process (MADV_DONTNEED); they stay in the page cache until written back, and reading them again faults them in from the file
+    // Call it when no tile in the flushed spans is still being written, e.g. between bands
+    int flush_dirty(bool release = false) {
+        if (!base_) return 0;
+        int flushed = 0;
+        size_t span_lo = 0, span_hi = 0;    // current merged span, file offsets
+        for (int t = 0; t < tile_count(); ++t) {
+            if (!dirty_[t].exchange(0, std::memory_order_acquire)) continue;
+            ++flushed;
+            const int tx = t % tiles_x_, ty = t / tiles_x_;
+            const int x0 = tx * tile_w_, y0 = ty * tile_h_;
+            const int x1 = std::min(x0 + tile_w_, width), y1 = std::min(y0 + tile_h_, height);
+            const size_t lo = header_size_ + 3 * (size_t(y0) * size_t(width) + size_t(x0));
+            const size_t hi = header_size_ + 3 * (size_t(y1 - 1) * size_t(width) + size_t(x1));
+            if (span_hi > span_lo && lo <= span_hi) {   // row-major tile order: spans start in increasing order, so overlap only needs the end check
+                span_hi = std::max(span_hi, hi);
+                continue;
+            }
+            sync_range(span_lo, span_hi, release);
+            span_lo = lo;
+            span_hi = hi;
+        }
+        sync_range(span_lo, span_hi, release);
+        return flushed;
+    }
+
+    // Write everything back and block until it is on disk
+    bool sync() {
+        if (!base_) return false;
+#if defined(_WIN32)
+        return FlushViewOfFile(base_, 0) && FlushFileBuffers(file_);
+#else
+        return msync(base_, size_, MS_SYNC) == 0;
+#endif
+    }
+
+    // Flush, unmap and close the file; the file is a complete PPM from here on
+    void close() {
+        if (!base_) return;
+        sync();
+#if defined(_WIN32)
+        UnmapViewOfFile(base_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+        mapping_ = file_ = INVALID_HANDLE_VALUE;
+#else
+        munmap(base_, size_);
+        ::close(fd_);
+        fd_ = -1;
+#endif
+        base_ = pixels_ = nullptr;
+        size_ = header_size_ = 0;
+        width = height = 0;
+        tiles_x_ = tiles_y_ = 0;
+        dirty_.reset();
+    }
+
+private:
+    uint8_t* base_ = nullptr;       // start of the mapping (PPM header)
+    uint8_t* pixels_ = nullptr;     // base_ + header_size_
+    size_t size_ = 0;
+    size_t header_size_ = 0;
+    int tile_w_ = 64, tile_h_ = 64, tiles_x_ = 0, tiles_y_ = 0;
+    std::unique_ptr<std::atomic<uint8_t>[]> dirty_;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+
+    bool map_file(const std::string& path, uint64_t total) {
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        // Sizing the mapping grows the file; no separate SetEndOfFile needed
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, DWORD(total >> 32), DWORD(total & 0xFFFFFFFFu), nullptr);
+        if (!mapping_) { CloseHandle(file_); file_ = mapping_ = INVALID_HANDLE_VALUE; return false; }
+        void* p = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size_t(total));
+        if (!p) { CloseHandle(mapping_); CloseHandle(file_); file_ = mapping_ = INVALID_HANDLE_VALUE; return false; }
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return false;
+        if (ftruncate(fd_, off_t(total)) != 0) { ::close(fd_); fd_ = -1; return false; }
+        void* p = mmap(nullptr, size_t(total), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) { ::close(fd_); fd_ = -1; return false; }
+#endif
+        base_ = static_cast<uint8_t*>(p);
+        size_ = size_t(total);
+        return true;
+    }
+
+    static size_t page_size() {
+#if defined(_WIN32)
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        return size_t(si.dwPageSize);
+#else
+        static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        return page;
+#endif
+    }
+
+    // msync needs a page-aligned start, so round [lo, hi) out to whole pages
+    void sync_range(size_t lo, size_t hi, bool release) {
+        if (hi <= lo) return;
+        const size_t page = page_size();
+        lo -= lo % page;
+        hi = std::min(size_, (hi + page - 1) / page * page);
+#if defined(_WIN32)
+        FlushViewOfFile(base_ + lo, hi - lo);
+        (void)release;      // no cheap equivalent of MADV_DONTNEED for file views; the working-set manager trims clean pages on its own
+#else
+        msync(base_ + lo, hi - lo, MS_ASYNC);
+        if (release) madvise(base_ + lo, hi - lo, MADV_DONTNEED);
+#endif
+    }
+};
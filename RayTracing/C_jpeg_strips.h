@@ -0,0 +1,140 @@
+// C_jpeg_strips.h
+#pragma once
+#include <cstdint>
+#include <cstdio>       // FILE*, fwrite
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>    // std::min, std::max
+#include "C_image.h"
+#include "C_thread_pool.h"
+#ifndef INCLUDE_STB_IMAGE_WRITE_H      // stb's implementation section has no guard of its own; skip the include if a TU already pulled it in
+#include "stb_image_write.h"            // declarations only; STB_IMAGE_WRITE_IMPLEMENTATION must be defined in exactly one .cpp/.cu of the program
+#endif
+
+// Parallel Programming + I/O
+// stbi_write_jpg encodes the whole image on one thread, which at 8K takes far longer than rendering it
+// This encoder cuts the image into horizontal strips, encodes every strip concurrently with stb's own encoder, and stitches one valid JPEG:
+    // JPEG "restart markers" (RST0..RST7) let a decoder reset its state every N MCUs (MCU = 16x16 block at quality <= 90, 8x8 above)
+    // at a restart the DC predictions start over from 0 and the bitstream is padded to a byte, which is exactly how a standalone JPEG starts and ends
+    // so each strip's entropy-coded data (the part after the SOS header) can be copied verbatim, with an RST marker between strips
+    // and a DRI segment in the header saying "restart every (MCUs per strip)"
+// Strips are whole MCU rows (except the last one), so the decoded pixels are identical to a single-threaded stbi_write_jpg at the same quality
+// Note: stbi_flip_vertically_on_write is not supported here; the rows are always written top to bottom
+
+namespace jpeg_strips_detail {
+
+inline void append_to_vector(void* context, void* data, int size) {
+    auto* out = static_cast<std::vector<uint8_t>*>(context);
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    out->insert(out->end(), p, p + size);
+}
+
+// Offsets inside one stb-encoded strip: where the SOF0 and SOS segments start and where the entropy-coded data begins/ends
+struct StripLayout {
+    size_t sof = 0, sos = 0, data_begin = 0, data_end = 0;
+    bool ok = false;
+};
+
+// Walk the marker segments (FF xx + 2-byte big-endian length) from SOI up to the start of scan
+inline StripLayout parse_strip(const std::vector<uint8_t>& j) {
+    StripLayout L;
+    if (j.size() < 4 || j[0] != 0xFF || j[1] != 0xD8) return L;     // must start with SOI
+    size_t p = 2;
+    while (p + 4 <= j.size() && j[p] == 0xFF) {
+        uint8_t marker = j[p + 1];
+        size_t len = (size_t(j[p + 2]) << 8) | j[p + 3];
+        if (marker == 0xC0) L.sof = p;
+        if (marker == 0xDA) {                                       // SOS: entropy-coded data follows its header
+            L.sos = p;
+            L.data_begin = p + 2 + len;
+            break;
+        }
+        p += 2 + len;
+    }
+    if (!L.sos || !L.sof || j.size() < L.data_begin + 2) return L;
+    if (j[j.size() - 2] != 0xFF || j[j.size() - 1] != 0xD9) return L;   // must end with EOI
+    L.data_end = j.size() - 2;
+    L.ok = true;
+    return L;
+}
+
+}   // namespace jpeg_strips_detail
+
+// Encode tightly packed RGB (3 bytes per pixel) to JPEG bytes; strip_rows = 0 picks about 4 strips per worker
+// Returns an empty vector on failure
+inline std::vector<uint8_t> encode_jpg_strips(const uint8_t* rgb, int width, int height, int quality, ThreadPool& pool, int strip_rows = 0) {
+    using namespace jpeg_strips_detail;
+    if (!rgb || width <= 0 || height <= 0 || width > 65535 || height > 65535) return {};
+
+    // Same MCU size rule as stb_image_write: chroma is subsampled (16x16 MCUs) at quality <= 90
+    const int q = quality ? quality : 90;
+    const int mcu = q <= 90 ? 16 : 8;
+    const int mcus_per_row = (width + mcu - 1) / mcu;
+    const int mcu_rows = (height + mcu - 1) / mcu;
+
+    // Strip height in MCU rows; the restart interval is a 16-bit MCU count
+    int strip_mcu_rows = strip_rows > 0 ? (strip_rows + mcu - 1) / mcu : (mcu_rows + 4 * pool.size() - 1) / (4 * pool.size());
+    strip_mcu_rows = std::max(1, std::min(strip_mcu_rows, 65535 / mcus_per_row));
+    const int num_strips = (mcu_rows + strip_mcu_rows - 1) / strip_mcu_rows;
+
+    std::vector<std::vector<uint8_t>> strips(num_strips);
+    std::atomic<int> next{ 0 };
+    std::atomic<bool> failed{ false };
+    pool.run([&](int) {
+        int k;
+        while ((k = next.fetch_add(1, std::memory_order_relaxed)) < num_strips) {
+            int y0 = k * strip_mcu_rows * mcu;
+            int rows = std::min(strip_mcu_rows * mcu, height - y0);
+            strips[k].reserve(size_t(width) * rows / 2);
+            if (!stbi_write_jpg_to_func(append_to_vector, &strips[k], width, rows, 3, rgb + size_t(y0) * width * 3, quality))
+                failed.store(true, std::memory_order_relaxed);
+        }
+        });
+    if (failed.load()) return {};
+
+    std::vector<StripLayout> layouts(num_strips);
+    size_t total = 0;
+    for (int k = 0; k < num_strips; ++k) {
+        layouts[k] = parse_strip(strips[k]);
+        if (!layouts[k].ok) return {};
+        total += layouts[k].data_end - layouts[k].data_begin + 2;
+    }
+
+    // Header of strip 0 (tables are identical in every strip) with the full image height and a DRI segment before SOS
+    const std::vector<uint8_t>& s0 = strips[0];
+    const StripLayout& L0 = layouts[0];
+    std::vector<uint8_t> out;
+    out.reserve(L0.data_begin + 6 + total + 2);
+    out.insert(out.end(), s0.begin(), s0.begin() + L0.sos);
+    out[L0.sof + 5] = uint8_t(height >> 8);         // SOF0: FF C0, length(2), precision(1), height(2), width(2), ...
+    out[L0.sof + 6] = uint8_t(height & 0xFF);
+    const int interval = strip_mcu_rows * mcus_per_row;
+    const uint8_t dri[] = { 0xFF, 0xDD, 0x00, 0x04, uint8_t(interval >> 8), uint8_t(interval & 0xFF) };
+    out.insert(out.end(), dri, dri + sizeof(dri));
+    out.insert(out.end(), s0.begin() + L0.sos, s0.begin() + L0.data_begin);
+
+    for (int k = 0; k < num_strips; ++k) {
+        out.insert(out.end(), strips[k].begin() + layouts[k].data_begin, strips[k].begin() + layouts[k].data_end);
+        if (k + 1 < num_strips) {                   // RST markers cycle through D0..D7
+            out.push_back(0xFF);
+            out.push_back(uint8_t(0xD0 + (k & 7)));
+        }
+    }
+    out.push_back(0xFF);                            // EOI
+    out.push_back(0xD9);
+    return out;
+}
+
+inline bool write_jpg_strips(const std::string& path, const uint8_t* rgb, int width, int height, int quality, ThreadPool& pool, int strip_rows = 0) {
+    std::vector<uint8_t> bytes = encode_jpg_strips(rgb, width, height, quality, pool, strip_rows);
+    if (bytes.empty()) return false;
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return (std::fclose(f) == 0) && ok;
+}
+
+inline bool write_jpg_strips(const std::string& path, const Image& img, int quality, ThreadPool& pool, int strip_rows = 0) {
+    return write_jpg_strips(path, img.pixels.data(), img.width, img.height, quality, pool, strip_rows);
+}
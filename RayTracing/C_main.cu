@@ -2,16 +2,28 @@
 #include <iostream>
 #include <vector>
 #include <cstdint>
+#include <cstring>      // std::memcpy
+#include <cstdio>       // std::remove for the --stream comparison's scratch file
+#include <string>
+#include <memory>
 #include <cuda_runtime.h>
 #include "C_image.h"     
 
 #include "C_timer.h"
 #include "C_render_cpu_baseline.h"
 #include "C_render_cpu_threads.h"
-// #include "C_render_cpu_openmp.h"
+#include "C_render_cpu_tiles.h"
+#include "C_image_mmap.h"                   // MappedImage for --mmap out-of-core renders
+#include "C_stream_writer.h"                // StreamWriter for --stream (also brings in write_ppm)
+#include "C_frame_pipeline.h"               // FramePipeline for --frames sequences
+#include "C_thread_pool.h"
+#include "C_perf_counters.h"
+#include "C_render_cpu_openmp.h"
+#include "C_renderer.h"                     // renderer registry: CPU backends are built in, "cuda" is registered below
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION      // shouldn't declare if 1_firstP3.cpp were part of RayTracingCUDA.exe under CMakeLists.txt
 #include "stb_image_write.h"                // Write jpg
+#include "C_jpeg_strips.h"                   // Write large jpgs in parallel strips on the thread pool
 
 
 // CUDA kernel for computing gradient on the GPU, saving the Image result as PPM
@@ -42,34 +54,223 @@ __global__ void gradient_kernel(uint8_t* pixels, int width, int height) {
     pixels[idx + 2] = (uint8_t)(255.99f * b);
 }
 
-int main() {
+// CUDA backend for the renderer registry (C_renderer.h)
+// The unified-memory buffer is allocated on the first render and kept while the resolution stays the same, so repeated renders time only the kernel and the copy
+class CudaRenderer final : public Renderer {
+public:
+    CudaRenderer(int block_w, int block_h) : block(block_w, block_h) {}
+    ~CudaRenderer() override { if (d_pixels) cudaFree(d_pixels); }
+
+    std::string name() const override { return "cuda"; }
+
+    void render(Image& img) override {
+        const size_t n = size_t(img.width) * img.height * 3;
+        if (n != capacity) {
+            if (d_pixels) cudaFree(d_pixels);
+            d_pixels = nullptr;
+            capacity = 0;
+            if (cudaMallocManaged(&d_pixels, n) != cudaSuccess) return;
+            capacity = n;
+        }
+        dim3 grid((img.width + block.x - 1) / block.x, (img.height + block.y - 1) / block.y);
+        gradient_kernel << <grid, block >> > (d_pixels, img.width, img.height);
+        cudaDeviceSynchronize();
+        std::memcpy(img.pixels.data(), d_pixels, n);
+    }
+
+private:
+    dim3 block;
+    uint8_t* d_pixels = nullptr;
+    size_t capacity = 0;
+};
+
+static RendererRegistration register_cuda({ "cuda", "gradient kernel on the GPU, unified memory [block=WxH, default 16x16]", [](const RendererOptions& o) {
+    int bw = 16, bh = 16;
+    o.get_size("block", bw, bh);
+    return std::unique_ptr<Renderer>(new CudaRenderer(bw, bh));
+    } });
+
+
+// Registry mode: RayTracingCUDA --list, or RayTracingCUDA [--res WxH] --backend NAME[:key=value,...] [--backend ...]
+// Renders once with each selected backend, prints its time and whether it matches the CPU baseline; without arguments main() runs the fixed comparison
+static int run_selected_backends(int argc, char** argv) {
+    int W = 7680, H = 4320;
+    std::vector<std::string> specs;
+    std::string mmap_path, stream_path;
+    std::string frame_pattern = "frame_%04d.jpg";
+    int frames = 0;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--list") {
+            print_renderers(std::cout);
+            return 0;
+        }
+        else if (arg == "--backend" && a + 1 < argc) specs.push_back(argv[++a]);
+        else if (arg == "--res" && a + 1 < argc && std::sscanf(argv[++a], "%dx%d", &W, &H) == 2 && W > 0 && H > 0) {}
+        else if (arg == "--mmap" && a + 1 < argc) mmap_path = argv[++a];
+        else if (arg == "--stream" && a + 1 < argc) stream_path = argv[++a];
+        else if (arg == "--frames" && a + 1 < argc) frames = std::atoi(argv[++a]);
+        else if (arg == "--out" && a + 1 < argc) frame_pattern = argv[++a];
+        else {
+            std::cerr << "usage: RayTracingCUDA [--list] [--res WxH] [--mmap OUT.ppm] [--stream OUT.ppm] [--frames N [--out frame_%04d.jpg]] [--backend NAME[:key=value,...]]...\n";
+            return 1;
+        }
+    }
+
+    // --out comes from the user, so it is parsed, never used as a printf format
+    std::string pattern_err;
+    FramePattern parsed_pattern;
+    if (frames > 0 && !parse_frame_pattern(frame_pattern, parsed_pattern, &pattern_err)) {
+        std::cerr << pattern_err << "\n";
+        return 1;
+    }
+
+    // Out-of-core render straight into a memory-mapped PPM (C_image_mmap.h), for sizes that do not fit in RAM: --res 65536x65536 --mmap poster.ppm
+    if (!mmap_path.empty()) {
+        MappedImage mapped;
+        if (!mapped.create(mmap_path, W, H)) {
+            std::cerr << "cannot map " << mmap_path << " for a " << W << "x" << H << " image\n";
+            return 1;
+        }
+        Timer timer;
+        timer.tic();
+        render_cpu_tiles(mapped, default_thread_pool());
+        mapped.close();             // flushes the last pages; the file is the finished PPM
+        std::cout << "mmap tiles -> " << mmap_path << ": " << timer.toc_ms() << " ms\n";
+    }
+
+    // Render start to file on disk, writing bands from an I/O thread while the rest renders (C_stream_writer.h), next to render-then-write
+    if (!stream_path.empty()) {
+        Timer timer;
+        timer.tic();
+        StreamWriter stream;
+        if (!stream.open_windowed(stream_path, W, H)) {
+            std::cerr << "cannot open " << stream_path << "\n";
+            return 1;
+        }
+        render_cpu_tiles_streamed(stream, default_thread_pool());
+        bool ok = stream.finish();
+        double streamed_ms = timer.toc_ms();
+
+        // The render-then-write comparison goes to a scratch file next to the output, deleted afterwards, so the streamed file is what stays on disk
+        const std::string serial_path = stream_path + ".serial.tmp";
+        timer.tic();
+        Image img(W, H);
+        render_cpu_tiles(img, default_thread_pool());
+        bool serial_ok = write_ppm(serial_path, img);
+        double serial_ms = timer.toc_ms();
+        std::remove(serial_path.c_str());
+        std::cout << "streamed tiles -> " << stream_path << ": " << streamed_ms << " ms (render then write: " << serial_ms << " ms" << (serial_ok ? "" : ", write failed") << ")"
+                  << (ok ? "" : "  [write failed]") << "\n";
+    }
+
+    // Frame sequence with the first --backend (default tiles_pool): frame N+1 renders while frame N is encoded and written on its own thread and pool (C_frame_pipeline.h)
+    if (frames > 0) {
+        std::string err;
+        std::unique_ptr<Renderer> renderer = RendererRegistry::instance().create(specs.empty() ? "tiles_pool" : specs[0], &err);
+        if (!renderer) {
+            std::cerr << err << "\n";
+            return 1;
+        }
+        ThreadPool encode_pool(std::max(1, int(std::thread::hardware_concurrency()) / 4));    // separate from the render pool, or the stages would serialize
+        FramePipeline<Image> pipeline(W, H, 2);
+        FrameStats fs = pipeline.run(0, frames, [&](int, Image& img) { renderer->render(img); }, frame_output_file(frame_pattern, encode_pool));
+        std::cout << "sequence of " << fs.frames << " frames -> " << frame_pattern << ": " << fs.total_ms << " ms, " << fs.fps() << " fps"
+                  << " (render " << fs.render_ms << " ms + output " << fs.output_ms << " ms if serialized)" << (fs.failed ? "  [write failed]" : "") << "\n";
+    }
+    if (specs.empty()) return 0;
+
+    Image reference(W, H);
+    render_cpu_baseline(reference);
+
+    for (const std::string& spec : specs) {
+        std::string err;
+        std::unique_ptr<Renderer> renderer = RendererRegistry::instance().create(spec, &err);
+        if (!renderer) {
+            std::cerr << err << "\n";
+            return 1;
+        }
+        Image img(W, H);
+        renderer->render(img);      // warmup: first-touch page faults, CUDA context and buffer setup
+        Timer timer;
+        timer.tic();
+        renderer->render(img);
+        double ms = timer.toc_ms();
+        std::cout << spec << ": " << ms << " ms" << (img.pixels == reference.pixels ? "" : "  [differs from CPU baseline]") << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) return run_selected_backends(argc, argv);
+
     const int W = 7680, H = 4320;
     const size_t bytes = W * H * 3;
 
+    // Hardware counters (cycles, IPC, cache/branch/dTLB misses) next to each CPU timing; opt-in with RT_PERF=1, prints n/a where unavailable
+    // Counters are started before tic() and stopped after toc_ms(), so the ioctl calls stay out of the timed region
+    PerfProfiler perf;
+
     // CPU Baseline
     Image img_cpu_base(W, H);   // Image is a CPU-side image class and expects standard CPU memory for saving .ppm and .jpg
     Timer timer_cpu_base;
+    perf.begin();
     timer_cpu_base.tic();
 
     render_cpu_baseline(img_cpu_base);   // Your CPU single-threaded function
     double cpu_base_time = timer_cpu_base.toc_ms();
+    PerfReport perf_base = perf.end();
 
     img_cpu_base.write_ppm("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_baseline.ppm");
-    stbi_write_jpg("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_baseline.jpg", W, H, 3, img_cpu_base.pixels.data(), 90);
+    write_jpg_strips("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_baseline.jpg", img_cpu_base, 90, default_thread_pool());
     std::cout << "CPU baseline execution time: " << cpu_base_time << " ms\n";
+    if (perf.enabled()) print_perf(std::cout, "CPU baseline", perf_base);
 
 
     // CPU multithreaded
     Image img_cpu_threads(W, H);
     Timer timer_threads;
+    perf.begin();
     timer_threads.tic();
 
     render_cpu_threads(img_cpu_threads);   // Your CPU multithreaded function
     double cpu_threads_time = timer_threads.toc_ms();
+    PerfReport perf_threads = perf.end();   // spawned threads are included through inherited counters
 
     img_cpu_threads.write_ppm("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_threads.ppm");
-    stbi_write_jpg("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_threads.jpg", W, H, 3, img_cpu_threads.pixels.data(), 90);
+    write_jpg_strips("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cpu_threads.jpg", img_cpu_threads, 90, default_thread_pool());
     std::cout << "CPU multi-threaded time: " << cpu_threads_time << " ms\n";
+    if (perf.enabled()) print_perf(std::cout, "CPU threads", perf_threads);
+
+
+    // CPU multithreaded, 64x64 tiles with work stealing
+    Image img_cpu_tiles(W, H);
+    Timer timer_tiles;
+    perf.begin();
+    timer_tiles.tic();
+
+    render_cpu_tiles(img_cpu_tiles);
+    double cpu_tiles_time = timer_tiles.toc_ms();
+    PerfReport perf_tiles = perf.end();
+
+    std::cout << "CPU tiled work-stealing time: " << cpu_tiles_time << " ms\n";
+    if (perf.enabled()) print_perf(std::cout, "CPU tiles", perf_tiles);
+
+
+    // CPU multithreaded on a persistent thread pool (threads are created once, outside the timed region, and reused)
+    ThreadPool& pool = default_thread_pool();
+    Image img_cpu_pool(W, H);
+    PerfProfiler perf_pool(&pool);          // one counter set per pool worker, for a per-worker breakdown
+    Timer timer_pool;
+    perf_pool.begin();
+    timer_pool.tic();
+
+    render_cpu_tiles(img_cpu_pool, pool);
+    double cpu_pool_time = timer_pool.toc_ms();
+    PerfReport perf_pool_report = perf_pool.end();
+
+    std::cout << "CPU thread pool (tiled) time: " << cpu_pool_time << " ms\n";
+    if (perf_pool.enabled()) print_perf(std::cout, "CPU thread pool", perf_pool_report);
 
 
     // CUDA GPU
@@ -95,7 +296,7 @@ int main() {
     Image img_cuda(W, H);   // copy the unified memory into the CPU Image object and save it
     std::memcpy(img_cuda.pixels.data(), d_pixels, bytes);
     img_cuda.write_ppm("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cuda_output.ppm");
-    stbi_write_jpg("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cuda_output.jpg", W, H, 3, d_pixels, 90);
+    write_jpg_strips("C:/Users/ohjin/OneDrive//GitHub/RayTracing/RayTracing/cuda_output.jpg", img_cuda, 90, default_thread_pool());
 
     cudaFree(d_pixels);     // free GPU memory
 
@@ -106,6 +307,8 @@ int main() {
     std::cout << "GPU speedup vs CPU baseline : " << (cpu_base_time / cuda_time) << "x\n";
     std::cout << "GPU speedup vs CPU threads : " << (cpu_threads_time / cuda_time) << "x\n";
     std::cout << "Multithreading speedup vs baseline : " << (cpu_base_time / cpu_threads_time) << "x\n";
+    std::cout << "Tiled work-stealing speedup vs baseline : " << (cpu_base_time / cpu_tiles_time) << "x\n";
+    std::cout << "Thread pool speedup vs baseline : " << (cpu_base_time / cpu_pool_time) << "x\n";
 
 
     return 0;
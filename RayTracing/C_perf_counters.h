@@ -0,0 +1,294 @@
+// C_perf_counters.h
+#pragma once
+#include <cstdint>
+#include <cstdlib>      // std::getenv for the RT_PERF opt-in, std::atoi for thread ids
+#include <cstring>      // std::memset
+#include <cstdio>       // std::snprintf
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>       // std::unique_ptr per-worker counter sets
+#include <algorithm>    // std::find
+#include "C_thread_pool.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>   // perf_event_attr, PERF_* constants
+#include <sys/syscall.h>        // SYS_perf_event_open (glibc has no wrapper)
+#include <sys/ioctl.h>          // PERF_EVENT_IOC_RESET/ENABLE/DISABLE
+#include <unistd.h>             // read, close
+#include <dirent.h>             // opendir/readdir over /proc/self/task
+#define RT_PERF_COUNTERS 1
+#else
+#define RT_PERF_COUNTERS 0
+#endif
+
+// Profiling
+// Timer (C_timer.h) says how long a render took, not why: the same 120 ms can be spent retiring instructions (compute-bound)
+// or waiting on DRAM (memory-bound), and the right optimization differs (SIMD/ILP vs. layout/tiling/prefetch)
+// The CPU's hardware performance counters answer that; on Linux they are read through perf_event_open(2):
+    // cycles, instructions  -> IPC = instructions / cycles; ~3-4 on a modern core means compute-bound, < 1 usually means stalls on memory
+    // cache misses          -> last-level cache misses, i.e. trips to DRAM
+    // branch misses         -> mispredicted branches, each one flushes ~15-20 cycles of work
+    // dTLB misses           -> data-TLB load misses, a sign of touching too many 4 KB pages (huge pages or better locality help)
+// Counters are opt-in (set RT_PERF=1, or bench --perf); they count user-space only (exclude_kernel), which works at the default perf_event_paranoid level
+// Each counter is opened on its own rather than as one group, so a missing event (VMs often hide the PMU or the dTLB event) only blanks that column
+// If the kernel multiplexes counters, values are scaled by time_enabled / time_running
+// Anything that cannot be measured (non-Linux, no PMU, paranoid level too high) prints as n/a
+
+enum PerfEventId { kPerfCycles, kPerfInstructions, kPerfCacheMisses, kPerfBranchMisses, kPerfDtlbMisses, kPerfEventCount };
+
+inline const char* perf_event_name(int e) {
+    static const char* names[kPerfEventCount] = { "cycles", "instructions", "cache-misses", "branch-misses", "dTLB-misses" };
+    return (e >= 0 && e < kPerfEventCount) ? names[e] : "?";
+}
+
+// One measurement: a value per event, and whether that event could be counted at all
+struct PerfCounts {
+    uint64_t value[kPerfEventCount] = {};
+    bool valid[kPerfEventCount] = {};
+
+    bool any_valid() const {
+        for (int e = 0; e < kPerfEventCount; ++e) if (valid[e]) return true;
+        return false;
+    }
+
+    double ipc() const {
+        return (valid[kPerfCycles] && valid[kPerfInstructions] && value[kPerfCycles])
+            ? double(value[kPerfInstructions]) / double(value[kPerfCycles]) : 0.0;
+    }
+};
+
+// Sum over workers; an event only counts as valid for the total if every worker could count it
+inline PerfCounts perf_sum(const std::vector<PerfCounts>& parts) {
+    PerfCounts total;
+    if (parts.empty()) return total;
+    for (int e = 0; e < kPerfEventCount; ++e) total.valid[e] = true;
+    for (const PerfCounts& p : parts)
+        for (int e = 0; e < kPerfEventCount; ++e) {
+            total.value[e] += p.value[e];
+            total.valid[e] = total.valid[e] && p.valid[e];
+        }
+    return total;
+}
+
+// True when the user asked for counters with RT_PERF=1 (any value other than empty or "0")
+inline bool perf_counters_requested() {
+    const char* v = std::getenv("RT_PERF");
+    return v && *v && !(v[0] == '0' && v[1] == '\0');
+}
+
+// Kernel thread id of the calling thread (what perf_event_open's pid argument means for a thread)
+inline int perf_current_tid() {
+#if RT_PERF_COUNTERS
+    return int(syscall(SYS_gettid));
+#else
+    return 0;
+#endif
+}
+
+// Thread ids of every thread of this process right now, from /proc/self/task; empty where that does not exist
+inline std::vector<int> perf_process_threads() {
+    std::vector<int> tids;
+#if RT_PERF_COUNTERS
+    if (DIR* dir = opendir("/proc/self/task")) {
+        while (dirent* e = readdir(dir)) {
+            const int tid = std::atoi(e->d_name);
+            if (tid > 0) tids.push_back(tid);
+        }
+        closedir(dir);
+    }
+#endif
+    return tids;
+}
+
+// The counters of one thread: open() on the thread to be measured, or open(inherit, tid) from another thread of the same process,
+// then start()/stop()/read() from any thread
+// With inherit = true, threads the measured thread creates after open() are counted too (their counts are added when they exit),
+// which covers renderers that spawn and join their own std::threads (render_cpu_threads, render_cpu_tiles without a pool)
+class PerfCounterSet {
+public:
+    PerfCounterSet() { for (int& f : fd) f = -1; }
+    ~PerfCounterSet() { close_all(); }
+
+    PerfCounterSet(const PerfCounterSet&) = delete;
+    PerfCounterSet& operator=(const PerfCounterSet&) = delete;
+
+    // Returns true if at least one event could be opened; tid 0 = the calling thread
+    bool open(bool inherit = false, int tid = 0) {
+        close_all();
+#if RT_PERF_COUNTERS
+        struct Event { uint32_t type; uint64_t config; };
+        const Event events[kPerfEventCount] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        };
+        for (int e = 0; e < kPerfEventCount; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[e].type;
+            attr.config = events[e].config;
+            attr.disabled = 1;                  // counts nothing until start()
+            attr.inherit = inherit ? 1 : 0;
+            attr.exclude_kernel = 1;            // user space only: allowed at perf_event_paranoid <= 2
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[e] = int(syscall(SYS_perf_event_open, &attr, tid /* 0 = this thread */, -1 /* any cpu */, -1 /* no group */, 0UL));
+        }
+#else
+        (void)inherit;
+        (void)tid;
+#endif
+        return is_open();
+    }
+
+    bool is_open() const {
+        for (int f : fd) if (f >= 0) return true;
+        return false;
+    }
+
+    void start() {
+#if RT_PERF_COUNTERS
+        for (int f : fd) if (f >= 0) { ioctl(f, PERF_EVENT_IOC_RESET, 0); ioctl(f, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+
+    void stop() {
+#if RT_PERF_COUNTERS
+        for (int f : fd) if (f >= 0) ioctl(f, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    PerfCounts read() const {
+        PerfCounts c;
+#if RT_PERF_COUNTERS
+        for (int e = 0; e < kPerfEventCount; ++e) {
+            if (fd[e] < 0) continue;
+            uint64_t buf[3];    // value, time_enabled, time_running
+            if (::read(fd[e], buf, sizeof(buf)) != ssize_t(sizeof(buf))) continue;
+            if (buf[2] == 0) { c.valid[e] = buf[0] == 0 && buf[1] == 0; continue; }    // never scheduled onto the PMU: no data (unless it never ran at all)
+            c.value[e] = buf[2] < buf[1] ? uint64_t(double(buf[0]) * double(buf[1]) / double(buf[2])) : buf[0];   // scale multiplexed counts
+            c.valid[e] = true;
+        }
+#endif
+        return c;
+    }
+
+private:
+    int fd[kPerfEventCount];
+
+    void close_all() {
+#if RT_PERF_COUNTERS
+        for (int& f : fd) if (f >= 0) { close(f); f = -1; }
+#endif
+    }
+};
+
+// Counters for one render invocation, total and per worker
+struct PerfReport {
+    PerfCounts total;                       // every thread of the process, pool workers or not
+    std::vector<PerfCounts> per_worker;     // index = ThreadPool worker; empty when no pool was given
+};
+
+// Measures render calls made from the thread that constructed it
+// Without a pool: one inherited counter set on the calling thread, so threads spawned inside the render are included in the total
+// With a pool: the calling thread is worker 0 (also inherited) and each other worker opens its own counter set once, on its own thread,
+// so the report has a per-worker breakdown (load imbalance shows up as uneven cycles, a memory-bound worker as a low IPC)
+// Either way every other thread that already exists (OpenMP's persistent team, a pool the renderer does not report) gets a counter set
+// by thread id, so it is in the total too; inheritance alone would miss them, since they were created before the counters were opened
+// Only threads created later by one of those other threads are not counted
+// When counters were not requested (enabled = false), begin/end do nothing and end() returns an all-n/a report
+class PerfProfiler {
+public:
+    explicit PerfProfiler(ThreadPool* pool = nullptr, bool enabled = perf_counters_requested()) : pool_(pool), enabled_(enabled) {
+        if (!enabled_) return;
+        const int n = pool_ ? pool_->size() : 1;
+        sets_.resize(n);
+        for (auto& s : sets_) s = std::make_unique<PerfCounterSet>();
+        std::vector<int> measured(n, 0);
+        measured[0] = perf_current_tid();
+        sets_[0]->open(true);
+        if (pool_ && n > 1)
+            pool_->run([&](int w) {
+                if (w == 0) return;
+                measured[w] = perf_current_tid();
+                sets_[w]->open(false);      // pid 0 in perf_event_open = the thread that calls it
+                });
+        for (int tid : perf_process_threads()) {
+            if (std::find(measured.begin(), measured.end(), tid) != measured.end()) continue;
+            auto s = std::make_unique<PerfCounterSet>();
+            if (s->open(true, tid)) others_.push_back(std::move(s));
+        }
+    }
+
+    bool enabled() const { return enabled_; }
+
+    void begin() {
+        for (auto& s : others_) s->start();
+        for (auto& s : sets_) s->start();
+    }
+
+    PerfReport end() {
+        PerfReport r;
+        for (auto& s : sets_) s->stop();
+        for (auto& s : others_) s->stop();
+        for (auto& s : sets_) r.per_worker.push_back(s->read());
+        std::vector<PerfCounts> all = r.per_worker;
+        for (auto& s : others_) all.push_back(s->read());
+        r.total = perf_sum(all);
+        if (!pool_) r.per_worker.clear();
+        return r;
+    }
+
+    // begin(); fn(); end()
+    template <typename F>
+    PerfReport measure(F&& fn) {
+        begin();
+        fn();
+        return end();
+    }
+
+private:
+    ThreadPool* pool_;
+    bool enabled_;
+    std::vector<std::unique_ptr<PerfCounterSet>> sets_;
+    std::vector<std::unique_ptr<PerfCounterSet>> others_;     // threads outside the pool, in the total only
+};
+
+// 1234567 -> "1.23M"
+inline std::string perf_format_count(uint64_t v) {
+    char buf[32];
+    if (v >= 1000000000ULL) std::snprintf(buf, sizeof(buf), "%.2fG", double(v) / 1e9);
+    else if (v >= 1000000ULL) std::snprintf(buf, sizeof(buf), "%.2fM", double(v) / 1e6);
+    else if (v >= 1000ULL) std::snprintf(buf, sizeof(buf), "%.2fK", double(v) / 1e3);
+    else std::snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+    return buf;
+}
+
+// "cycles 1.20G  instructions 2.41G  IPC 2.01  cache-misses 3.10M  branch-misses 120.00K  dTLB-misses n/a"
+inline void print_perf_counts(std::ostream& out, const PerfCounts& c) {
+    for (int e = 0; e < kPerfEventCount; ++e) {
+        out << (e ? "  " : "") << perf_event_name(e) << " " << (c.valid[e] ? perf_format_count(c.value[e]) : std::string("n/a"));
+        if (e == kPerfInstructions) {
+            char buf[16];
+            std::snprintf(buf, sizeof(buf), "%.2f", c.ipc());
+            out << "  IPC " << (c.valid[kPerfCycles] && c.valid[kPerfInstructions] ? buf : "n/a");
+        }
+    }
+}
+
+// Total on one line after a label, then one indented line per worker when there is more than one
+inline void print_perf(std::ostream& out, const char* label, const PerfReport& r) {
+    out << "  [perf] " << label << ": ";
+    print_perf_counts(out, r.total);
+    out << "\n";
+    if (r.per_worker.size() > 1)
+        for (size_t w = 0; w < r.per_worker.size(); ++w) {
+            out << "    worker " << w << ": ";
+            print_perf_counts(out, r.per_worker[w]);
+            out << "\n";
+        }
+}
@@ -0,0 +1,116 @@
+// C_ppm_writer.h
+#pragma once
+#include <cstdio>       // FILE*, fopen, fwrite - one large write instead of many small iostream insertions
+#include <cstdint>
+#include <cstring>      // std::memcpy
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>    // std::min
+#include "C_image.h"
+#include "C_thread_pool.h"
+
+// I/O Optimization
+// Bulk PPM writer for whole images or row spans, replacing per-pixel 'out << r << ' ' << g ...' (color.h write_color, 1_firstP3.cpp, 2_shortP3.cpp)
+// P6 (binary) is the default: the header plus the raw RGB bytes, written with a single fwrite
+// P3 (ASCII) is what the tutorial programs produce; it is formatted without iostreams or printf:
+    // a 256-entry table holds the decimal text of every byte value, so each channel is a table lookup and a 4-byte copy
+    // rows are formatted into per-chunk buffers in parallel on a ThreadPool, then written in order with large fwrite calls
+// The P3 text is identical to write_color's: "r g b\n" per pixel
+
+enum class PpmFormat { P3, P6 };
+
+// Decimal text for 0..255; each entry is padded to 4 bytes so it can be copied with one fixed-size memcpy, and len says how many bytes count
+struct PpmDigitTable {
+    char text[256][4];
+    uint8_t len[256];
+
+    PpmDigitTable() {
+        for (int v = 0; v < 256; ++v) {
+            char tmp[4] = { 0, 0, 0, 0 };
+            int n = 0;
+            if (v >= 100) tmp[n++] = char('0' + v / 100);
+            if (v >= 10) tmp[n++] = char('0' + (v / 10) % 10);
+            tmp[n++] = char('0' + v % 10);
+            std::memcpy(text[v], tmp, 4);
+            len[v] = uint8_t(n);
+        }
+    }
+};
+
+inline const PpmDigitTable& ppm_digit_table() {
+    static const PpmDigitTable table;
+    return table;
+}
+
+// Worst case per pixel is "255 255 255\n" = 12 bytes
+constexpr size_t kPpmP3MaxBytesPerPixel = 12;
+
+// Format 'count' RGB pixels as P3 text into out (needs count * 12 bytes + 3 spare for the padded copies); returns bytes written
+inline size_t format_p3_pixels(const uint8_t* rgb, size_t count, char* out) {
+    const PpmDigitTable& t = ppm_digit_table();
+    char* p = out;
+    for (size_t i = 0; i < count; ++i, rgb += 3) {
+        std::memcpy(p, t.text[rgb[0]], 4); p += t.len[rgb[0]]; *p++ = ' ';
+        std::memcpy(p, t.text[rgb[1]], 4); p += t.len[rgb[1]]; *p++ = ' ';
+        std::memcpy(p, t.text[rgb[2]], 4); p += t.len[rgb[2]]; *p++ = '\n';
+    }
+    return size_t(p - out);
+}
+
+inline bool write_ppm_header(FILE* f, PpmFormat fmt, int width, int height) {
+    return std::fprintf(f, "%s\n%d %d\n255\n", fmt == PpmFormat::P6 ? "P6" : "P3", width, height) > 0;
+}
+
+// Write 'rows' rows of tightly packed RGB (width * 3 bytes per row) without a header; for streaming an image out a band at a time
+// P3 rows are formatted in chunks of rows_per_chunk rows; with a pool, pool.size() * 2 chunks are formatted in parallel before each batch of writes
+inline bool write_ppm_rows(FILE* f, PpmFormat fmt, const uint8_t* rgb, int width, int rows, ThreadPool* pool = nullptr, int rows_per_chunk = 16) {
+    const size_t row_bytes = size_t(width) * 3;
+    if (fmt == PpmFormat::P6) return std::fwrite(rgb, 1, row_bytes * rows, f) == row_bytes * rows;
+
+    rows_per_chunk = std::max(1, rows_per_chunk);
+    const int num_chunks = (rows + rows_per_chunk - 1) / rows_per_chunk;
+    const int batch = pool ? pool->size() * 2 : 1;      // chunks formatted per round; bounds the memory used for text
+    const size_t chunk_capacity = size_t(width) * rows_per_chunk * kPpmP3MaxBytesPerPixel + 4;
+
+    std::vector<std::vector<char>> bufs(batch, std::vector<char>(chunk_capacity));
+    std::vector<size_t> lens(batch);
+
+    for (int c0 = 0; c0 < num_chunks; c0 += batch) {
+        const int n = std::min(batch, num_chunks - c0);
+        auto format_chunk = [&](int k) {
+            int y0 = (c0 + k) * rows_per_chunk;
+            int y1 = std::min(rows, y0 + rows_per_chunk);
+            lens[k] = format_p3_pixels(rgb + row_bytes * y0, size_t(width) * (y1 - y0), bufs[k].data());
+            };
+        if (pool) {
+            std::atomic<int> next{ 0 };
+            pool->run([&](int) {
+                int k;
+                while ((k = next.fetch_add(1, std::memory_order_relaxed)) < n) format_chunk(k);
+                });
+        }
+        else {
+            for (int k = 0; k < n; ++k) format_chunk(k);
+        }
+        for (int k = 0; k < n; ++k)     // chunks must reach the file in row order
+            if (std::fwrite(bufs[k].data(), 1, lens[k], f) != lens[k]) return false;
+    }
+    return true;
+}
+
+// Whole image to an open FILE* (e.g. stdout); on Windows, stdout must be in binary mode for P6
+inline bool write_ppm(FILE* f, const uint8_t* rgb, int width, int height, PpmFormat fmt = PpmFormat::P6, ThreadPool* pool = nullptr) {
+    return write_ppm_header(f, fmt, width, height) && write_ppm_rows(f, fmt, rgb, width, height, pool);
+}
+
+inline bool write_ppm(const std::string& path, const uint8_t* rgb, int width, int height, PpmFormat fmt = PpmFormat::P6, ThreadPool* pool = nullptr) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = write_ppm(f, rgb, width, height, fmt, pool);
+    return (std::fclose(f) == 0) && ok;
+}
+
+inline bool write_ppm(const std::string& path, const Image& img, PpmFormat fmt = PpmFormat::P6, ThreadPool* pool = nullptr) {
+    return write_ppm(path, img.pixels.data(), img.width, img.height, fmt, pool);
+}
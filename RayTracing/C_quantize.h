@@ -0,0 +1,99 @@
+// C_quantize.h
+#pragma once
+#include <cstdint>      // uint8_t
+#include <cstddef>      // size_t
+#include "C_cpu_features.h"
+#ifdef RT_X86
+#include <immintrin.h>  // SSE2 / AVX2 / AVX-512 intrinsics
+#endif
+
+// SIMD Optimization
+// Converts float color channels in [0,1] to bytes, (uint8_t)(255.99f * x), for a whole row or tile at once instead of one channel at a time
+// Input and output are both interleaved RGB (AoS), so float k maps to byte k and no shuffling is needed: the same kernel handles rows, tiles and whole images
+// Renderers write a short float row into a stack buffer, then call quantize_rgb8 on it; the vector kernels convert 16 (SSE2), 32 (AVX2) or 64 (AVX-512) channels per loop
+// Values are clamped to [0,255] in float before the truncating conversion, so NaN, infinities and huge inputs give the same byte as the scalar code
+    // (converting first would not do: cvttps returns INT_MIN for anything out of int32 range, which the packs then saturate to 0 instead of 255)
+
+// Number of pixels renderers convert per call; 256 RGB floats = 3 KB stack buffer that stays in L1
+constexpr int kQuantizeChunk = 256;
+
+// Scalar reference, also used for the tail that does not fill a whole vector
+inline uint8_t quantize_channel(float x) {
+    float v = 255.99f * x;
+    if (!(v > 0.0f)) return 0;      // negative or NaN
+    if (v >= 255.0f) return 255;
+    return (uint8_t)v;
+}
+
+inline void quantize_rgb8_scalar(const float* in, uint8_t* out, size_t n) {
+    for (size_t k = 0; k < n; ++k) out[k] = quantize_channel(in[k]);
+}
+
+#ifdef RT_X86
+// SSE2: 4 x (4 floats -> 4 int32), then two saturating packs 32->16->8 bits give 16 bytes
+inline void quantize_rgb8_sse2(const float* in, uint8_t* out, size_t n) {
+    const __m128 scale = _mm_set1_ps(255.99f), zero = _mm_setzero_ps(), top = _mm_set1_ps(255.0f);
+    // max(v, 0) returns its second operand when v is NaN, so NaN becomes 0 like the scalar code (the AVX/AVX-512 max does the same)
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + k + 0), scale), zero), top));       // cvtt = convert with truncation, same as the (uint8_t) cast
+        __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + k + 4), scale), zero), top));
+        __m128i c = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + k + 8), scale), zero), top));
+        __m128i d = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + k + 12), scale), zero), top));
+        __m128i ab = _mm_packs_epi32(a, b);         // int32 -> int16 (signed saturation)
+        __m128i cd = _mm_packs_epi32(c, d);
+        _mm_storeu_si128((__m128i*)(out + k), _mm_packus_epi16(ab, cd));    // int16 -> uint8 (unsigned saturation clamps to [0,255])
+    }
+    quantize_rgb8_scalar(in + k, out + k, n - k);
+}
+
+// AVX2: same idea on 8-wide registers; the packs work within 128-bit lanes, so a final permute puts the 32 bytes back in order
+RT_TARGET_AVX2 inline void quantize_rgb8_avx2(const float* in, uint8_t* out, size_t n) {
+    const __m256 scale = _mm256_set1_ps(255.99f), zero = _mm256_setzero_ps(), top = _mm256_set1_ps(255.0f);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i a = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + k + 0), scale), zero), top));
+        __m256i b = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + k + 8), scale), zero), top));
+        __m256i c = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + k + 16), scale), zero), top));
+        __m256i d = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + k + 24), scale), zero), top));
+        __m256i ab = _mm256_packs_epi32(a, b);
+        __m256i cd = _mm256_packs_epi32(c, d);
+        __m256i bytes = _mm256_packus_epi16(ab, cd);
+        _mm256_storeu_si256((__m256i*)(out + k), _mm256_permutevar8x32_epi32(bytes, order));
+    }
+    quantize_rgb8_sse2(in + k, out + k, n - k);
+}
+
+// AVX-512: after the float clamp every lane is in [0,255], and vpmovusdb narrows 16 lanes straight to 16 bytes
+RT_TARGET_AVX512 inline void quantize_rgb8_avx512(const float* in, uint8_t* out, size_t n) {
+    const __m512 scale = _mm512_set1_ps(255.99f), zero = _mm512_setzero_ps(), top = _mm512_set1_ps(255.0f);
+    size_t k = 0;
+    for (; k + 64 <= n; k += 64) {
+        for (int q = 0; q < 4; ++q) {
+            const __m512 v = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(in + k + 16 * q), scale), zero), top);
+            _mm_storeu_si128((__m128i*)(out + k + 16 * q), _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(v)));
+        }
+    }
+    quantize_rgb8_sse2(in + k, out + k, n - k);
+}
+#endif
+
+using QuantizeFn = void (*)(const float*, uint8_t*, size_t);
+
+// Kernel for a given instruction set; asking for a level the CPU lacks is the caller's responsibility
+inline QuantizeFn quantize_kernel_for(SimdLevel level) {
+#ifdef RT_X86
+    switch (level) {
+    case SimdLevel::AVX512: return quantize_rgb8_avx512;
+    case SimdLevel::AVX2: return quantize_rgb8_avx2;
+    case SimdLevel::SSE2: return quantize_rgb8_sse2;
+    default: break;
+    }
+#else
+    (void)level;
+#endif
+    return quantize_rgb8_scalar;
+}
+
+// The dispatched front end, quantize_rgb8(in, out, n), lives in C_cpu_dispatch.h with the other runtime-selected kernels
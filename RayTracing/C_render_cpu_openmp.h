@@ -1,6 +1,8 @@
 // C_render_cpu_openmp.h
 #pragma once
 #include "C_image.h"
+#include "C_cpu_dispatch.h"
+#include <algorithm>    // std::min
 #ifdef _OPENMP      // compile with or without OpenMP available
 #include <omp.h>
 #endif
@@ -14,14 +16,12 @@ inline void render_cpu_openmp(Image& img) {
 #pragma omp parallel for schedule(dynamic, 4)   // split rows across threads, allowing threads to grab rows in chunks of 4 for better load balancing for uneven work
     for (int j = 0; j < ny; ++j) {
         int jj = ny - 1 - j;
-        for (int i = 0; i < nx; ++i) {
-            float r = float(i) / float(nx);
-            float g = float(jj) / float(ny);
-            float b = 0.2f;
-            auto* p = img.pixel_ptr(i, j);
-            p[0] = (uint8_t)(255.99f * r);
-            p[1] = (uint8_t)(255.99f * g);
-            p[2] = (uint8_t)(255.99f * b);
+        const CpuKernels& kern = cpu_kernels();
+        float buf[3 * kQuantizeChunk];      // per-thread row chunk, shaded and converted to bytes in bulk (C_cpu_dispatch.h)
+        for (int i0 = 0; i0 < nx; i0 += kQuantizeChunk) {
+            int n = std::min(kQuantizeChunk, nx - i0);
+            kern.gradient_span(buf, i0, n, jj, nx, ny);
+            kern.quantize_rgb8(buf, img.pixel_ptr(i0, j), size_t(3) * n);
         }
     }
 }
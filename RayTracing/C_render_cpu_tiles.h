@@ -0,0 +1,102 @@
+// C_render_cpu_tiles.h
+#pragma once
+#include <thread>       // std::thread for creating worker threads
+#include <vector>
+#include <algorithm>    // std::max, std::min
+#include "C_image.h"    // to write pixels in Image containers
+#include "C_image_mmap.h"   // MappedImage, for renders larger than RAM
+#include "C_stream_writer.h"    // StreamWriter, for writing the file while rendering
+#include "C_tile_scheduler.h"
+#include "C_thread_pool.h"
+#include "C_cpu_dispatch.h"
+
+// Parallel Programming
+// Same gradient as C_render_cpu_threads.h, but the unit of work is a 2D tile handed out by a work-stealing TileScheduler instead of a full row from one shared atomic counter
+// Tile size is configurable; 64x64 keeps a tile's pixels (12 KB of RGB) well inside L1/L2 while giving plenty of tiles to balance across many cores
+
+// Render the gradient into one tile; flip y the same way the other CPU renderers do so all outputs are identical
+// Each tile row is shaded into a small float buffer first and then converted to bytes in bulk, with the SIMD kernels picked at startup (C_cpu_dispatch.h)
+// Templated on the image so it also renders straight into a memory-mapped MappedImage (C_image_mmap.h); any type with width, height and pixel_ptr(x, y) works
+template <typename ImageT>
+inline void render_gradient_tile(ImageT& img, const Tile& t) {
+    const int nx = img.width, ny = img.height;
+    const CpuKernels& kern = cpu_kernels();
+    float buf[3 * kQuantizeChunk];
+    for (int j = t.y0; j < t.y1; ++j) {
+        int jj = ny - 1 - j;
+        for (int i0 = t.x0; i0 < t.x1; i0 += kQuantizeChunk) {
+            int n = std::min(kQuantizeChunk, t.x1 - i0);
+            kern.gradient_span(buf, i0, n, jj, nx, ny);
+            kern.quantize_rgb8(buf, img.pixel_ptr(i0, j), size_t(3) * n);    // pixels of a tile row are contiguous in the Image
+        }
+    }
+}
+
+// Define inline function with Image, num_threads (default of 1 per core) and tile size as input
+inline void render_cpu_tiles(Image& img, int num_threads = std::thread::hardware_concurrency(), int tile_w = 64, int tile_h = 64) {
+    num_threads = std::max(1, num_threads);     // hardware_concurrency() may return 0 if it cannot tell
+    const std::vector<Tile> tiles = make_tiles(img.width, img.height, tile_w, tile_h);
+    TileScheduler sched(int(tiles.size()), num_threads);
+
+    auto worker = [&](int w) {      // each worker knows its own index so the scheduler can use its queue
+        int t;
+        while (sched.next(w, t)) render_gradient_tile(img, tiles[t]);
+        };
+
+    std::vector<std::thread> pool;
+    pool.reserve(num_threads);
+    for (int w = 0; w < num_threads; ++w) pool.emplace_back(worker, w);
+    for (auto& th : pool) th.join();
+}
+
+// Tiled work stealing on the workers of a persistent ThreadPool; one scheduler queue per pool worker
+inline void render_cpu_tiles(Image& img, ThreadPool& pool, int tile_w = 64, int tile_h = 64) {
+    const std::vector<Tile> tiles = make_tiles(img.width, img.height, tile_w, tile_h);
+    TileScheduler sched(int(tiles.size()), pool.size());
+
+    pool.run([&](int w) {
+        int t;
+        while (sched.next(w, t)) render_gradient_tile(img, tiles[t]);
+        });
+}
+
+// Out-of-core version for a memory-mapped image (C_image_mmap.h): tiles are rendered one band (row of tiles) at a time with work stealing inside the band,
+// marked dirty as they finish, and the band is flushed and released before the next one starts, so resident memory stays at about one band
+// (tile_h rows x width x 3 bytes) however tall the image is; the tile grid is the image's own dirty-tracking grid
+inline void render_cpu_tiles(MappedImage& img, ThreadPool& pool) {
+    const std::vector<Tile> tiles = make_tiles(img.width, img.height, img.tile_width(), img.tile_height());
+    const int per_band = img.tiles_x();
+
+    for (int band = 0; band < img.tiles_y(); ++band) {
+        const int first = band * per_band;
+        TileScheduler sched(per_band, pool.size());
+        pool.run([&](int w) {
+            int t;
+            while (sched.next(w, t)) {
+                render_gradient_tile(img, tiles[first + t]);
+                img.mark_dirty(first + t);
+            }
+            });
+        img.flush_dirty(true);
+    }
+}
+
+// Streaming version (C_stream_writer.h): tiles go straight into the writer's frame or band window and are submitted as they finish, so the I/O thread writes
+// the top of the image while the bottom is still being rendered; tiles are tile_w x out.band_rows() so each tile belongs to exactly one band
+// Work stealing from contiguous per-worker blocks would finish the bands of every block at the very end, so tiles are claimed from one row-major counter instead:
+// bands then complete top to bottom, and in window mode a worker only waits when it is window_bands bands ahead of the disk
+// Call out.finish() afterwards to wait for the last band and close the file
+inline void render_cpu_tiles_streamed(StreamWriter& out, ThreadPool& pool, int tile_w = 64) {
+    const int tile_h = out.band_rows();
+    const std::vector<Tile> tiles = make_tiles(out.width, out.height, tile_w, tile_h);
+    std::atomic<int> next{ 0 };
+
+    pool.run([&](int) {
+        int t;
+        while ((t = next.fetch_add(1, std::memory_order_relaxed)) < int(tiles.size())) {
+            out.wait_band_writable(tiles[t].y0 / tile_h);
+            render_gradient_tile(out, tiles[t]);
+            out.submit(tiles[t]);
+        }
+        });
+}
@@ -0,0 +1,285 @@
+// C_renderer.h
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>       // std::unique_ptr for created renderers and owned pools
+#include <functional>   // std::function factories
+#include <cstdlib>      // std::strtol
+#include <cctype>       // std::isdigit
+#include <cerrno>       // ERANGE from std::strtol
+#include <climits>      // INT_MIN, INT_MAX
+#include <thread>
+#include <algorithm>    // std::sort
+#include <ostream>
+#include "C_image.h"
+#include "C_thread_pool.h"
+#include "C_render_cpu_baseline.h"
+#include "C_render_cpu_threads.h"
+#include "C_render_cpu_tiles.h"
+#include "C_render_cpu_openmp.h"
+
+// Renderer interface + runtime registry
+// The backends used to be free functions with different shapes (render_cpu_threads(Image&, int), render_cpu_tiles(Image&, ThreadPool&, int, int), a CUDA kernel inside main)
+// so every launcher (C_main.cu, C_bench.cpp) hard-coded which ones it called; switching engines meant editing and recompiling
+// Now every backend is a Renderer with one entry point, render(Image&), created by name from a registry:
+    // "tiles"                      -> tiled work stealing with default settings
+    // "tiles:threads=8,tile=32x32" -> same backend, options passed as comma-separated key=value pairs after a ':'
+// Options are parsed once when the renderer is created, and per-backend state (thread pools, GPU buffers) lives in the renderer object, so render() does only the work
+// Built-in CPU backends are registered on first use; other translation units add theirs with a static RendererRegistration (C_main.cu registers "cuda")
+
+// key=value options for one renderer; unknown keys and values the factory could not parse are reported by the registry,
+// so typos don't silently fall back to defaults
+class RendererOptions {
+public:
+    // "threads=8,tile=32x32" -> {threads: 8, tile: 32x32}; returns false (and sets err) on an entry without '='
+    static bool parse(const std::string& text, RendererOptions& out, std::string* err = nullptr) {
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t comma = text.find(',', pos);
+            if (comma == std::string::npos) comma = text.size();
+            std::string item = text.substr(pos, comma - pos);
+            pos = comma + 1;
+            if (item.empty()) continue;
+            size_t eq = item.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                if (err) *err = "bad option '" + item + "', expected key=value";
+                return false;
+            }
+            out.set(item.substr(0, eq), item.substr(eq + 1));
+        }
+        return true;
+    }
+
+    void set(const std::string& key, const std::string& value) { values[key] = value; }
+    bool has(const std::string& key) const { return values.count(key) != 0; }
+
+    std::string get(const std::string& key, const std::string& def = "") const {
+        used[key] = true;
+        auto it = values.find(key);
+        return it == values.end() ? def : it->second;
+    }
+
+    // Integer option; a value that is not a whole int (threads=abc, threads=8x) or is below min_value (threads=0) is recorded in invalid()
+    // and def is returned
+    int get_int(const std::string& key, int def, int min_value = INT_MIN) const {
+        std::string v = get(key);
+        if (!has(key)) return def;
+        int n;
+        if (!parse_int(v.c_str(), n, nullptr) || n < min_value) {
+            mark_invalid(key, v, min_value == INT_MIN ? std::string("an integer") : "an integer >= " + std::to_string(min_value));
+            return def;
+        }
+        return n;
+    }
+
+    // "WxH" or a single "N" for N x N; returns false if the key is absent, and also records the value in invalid() if it is malformed
+    // (tile=abc, tile=64x, tile=0) - w and h are only written on success
+    bool get_size(const std::string& key, int& w, int& h) const {
+        std::string v = get(key);
+        if (!has(key)) return false;
+        int pw, ph;
+        const char* rest = nullptr;
+        bool ok = parse_int(v.c_str(), pw, &rest);
+        if (ok && *rest == 'x') ok = parse_int(rest + 1, ph, nullptr);
+        else if (ok) {
+            ok = *rest == '\0';
+            ph = pw;
+        }
+        if (!ok || pw <= 0 || ph <= 0) {
+            mark_invalid(key, v, "a size WxH or N");
+            return false;
+        }
+        w = pw;
+        h = ph;
+        return true;
+    }
+
+    // Values a get_* call could not parse, as "key=value (expected ...)", in the order they were read
+    const std::vector<std::string>& invalid() const { return bad; }
+
+    // Keys that were set but never read by the factory
+    std::vector<std::string> unused() const {
+        std::vector<std::string> keys;
+        for (const auto& kv : values) if (!used.count(kv.first)) keys.push_back(kv.first);
+        return keys;
+    }
+
+    const std::map<std::string, std::string>& all() const { return values; }
+
+private:
+    std::map<std::string, std::string> values;
+    mutable std::map<std::string, bool> used;
+    mutable std::vector<std::string> bad;
+
+    // Decimal int at the start of s with nothing else after it, or, with 'rest', followed by whatever rest points to; rejects overflow
+    static bool parse_int(const char* s, int& out, const char** rest) {
+        if (!std::isdigit((unsigned char)*s) && !((*s == '-' || *s == '+') && std::isdigit((unsigned char)s[1]))) return false;
+        errno = 0;
+        char* end = nullptr;
+        long n = std::strtol(s, &end, 10);
+        if (errno == ERANGE || n < INT_MIN || n > INT_MAX) return false;
+        if (rest) *rest = end;
+        else if (*end != '\0') return false;
+        out = int(n);
+        return true;
+    }
+
+    void mark_invalid(const std::string& key, const std::string& value, const std::string& expected) const {
+        bad.push_back(key + "=" + value + " (expected " + expected + ")");
+    }
+};
+
+// One execution engine; render() fills img completely
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    virtual std::string name() const = 0;
+    virtual void render(Image& img) = 0;
+
+    // The pool the renderer runs on, if any; lets profilers (C_perf_counters.h) attach to its workers
+    virtual ThreadPool* thread_pool() const { return nullptr; }
+};
+
+// Adapter for backends that are a plain function; 'pool' is optional and owned when 'owned_pool' is set
+class FunctionRenderer final : public Renderer {
+public:
+    FunctionRenderer(std::string n, std::function<void(Image&)> fn, ThreadPool* pool = nullptr, std::unique_ptr<ThreadPool> owned_pool = nullptr)
+        : name_(std::move(n)), fn_(std::move(fn)), pool_(pool), owned_pool_(std::move(owned_pool)) {}
+
+    std::string name() const override { return name_; }
+    void render(Image& img) override { fn_(img); }
+    ThreadPool* thread_pool() const override { return pool_; }
+
+private:
+    std::string name_;
+    std::function<void(Image&)> fn_;
+    ThreadPool* pool_;
+    std::unique_ptr<ThreadPool> owned_pool_;
+};
+
+struct RendererInfo {
+    std::string name;
+    std::string description;    // one line, including the accepted options
+    std::function<std::unique_ptr<Renderer>(const RendererOptions&)> create;
+};
+
+class RendererRegistry {
+public:
+    // Process-wide registry, with the built-in CPU backends already in it
+    static RendererRegistry& instance() {
+        static RendererRegistry registry(true);
+        return registry;
+    }
+
+    explicit RendererRegistry(bool with_builtins = false) {
+        if (with_builtins) register_builtins();
+    }
+
+    // Returns false if the name is taken
+    bool add(RendererInfo info) {
+        if (find(info.name)) return false;
+        entries.push_back(std::move(info));
+        return true;
+    }
+
+    const RendererInfo* find(const std::string& name) const {
+        for (const RendererInfo& e : entries) if (e.name == name) return &e;
+        return nullptr;
+    }
+
+    // Registered backends sorted by name
+    std::vector<const RendererInfo*> list() const {
+        std::vector<const RendererInfo*> out;
+        for (const RendererInfo& e : entries) out.push_back(&e);
+        std::sort(out.begin(), out.end(), [](const RendererInfo* a, const RendererInfo* b) { return a->name < b->name; });
+        return out;
+    }
+
+    // "name" or "name:key=value,key=value"; returns nullptr and sets err for an unknown name, malformed options, options the backend does not take
+    // or values it could not parse
+    std::unique_ptr<Renderer> create(const std::string& spec, std::string* err = nullptr) const {
+        size_t colon = spec.find(':');
+        std::string name = spec.substr(0, colon);
+        RendererOptions opts;
+        if (colon != std::string::npos && !RendererOptions::parse(spec.substr(colon + 1), opts, err)) return nullptr;
+
+        const RendererInfo* info = find(name);
+        if (!info) {
+            if (err) *err = "unknown renderer '" + name + "'";
+            return nullptr;
+        }
+        std::unique_ptr<Renderer> r = info->create(opts);
+        if (!r) {
+            if (err) *err = "renderer '" + name + "' could not be created";
+            return nullptr;
+        }
+        if (!opts.invalid().empty()) {
+            if (err) *err = "renderer '" + name + "': bad value " + opts.invalid()[0];
+            return nullptr;
+        }
+        std::vector<std::string> unused = opts.unused();
+        if (!unused.empty()) {
+            if (err) *err = "renderer '" + name + "' does not take option '" + unused[0] + "'";
+            return nullptr;
+        }
+        return r;
+    }
+
+private:
+    std::vector<RendererInfo> entries;
+
+    static int default_threads() { return std::max(1, int(std::thread::hardware_concurrency())); }
+
+    // threads=N for every CPU backend: at least 1, so threads=0 or a negative count is rejected by create() instead of rendering nothing
+    static int get_threads(const RendererOptions& o) { return o.get_int("threads", default_threads(), 1); }
+
+    void register_builtins() {
+        add({ "baseline", "single-threaded reference loop", [](const RendererOptions&) {
+            return std::make_unique<FunctionRenderer>("baseline", [](Image& img) { render_cpu_baseline(img); });
+            } });
+
+        add({ "threads", "std::thread per call, rows from a shared counter [threads=N]", [](const RendererOptions& o) {
+            int n = get_threads(o);
+            return std::make_unique<FunctionRenderer>("threads", [n](Image& img) { render_cpu_threads(img, n); });
+            } });
+
+        add({ "threads_pool", "rows from a shared counter on a persistent pool [threads=N, default: shared pool]", [](const RendererOptions& o) {
+            auto owned = o.has("threads") ? std::make_unique<ThreadPool>(get_threads(o)) : nullptr;
+            ThreadPool* pool = owned ? owned.get() : &default_thread_pool();
+            return std::make_unique<FunctionRenderer>("threads_pool", [pool](Image& img) { render_cpu_threads(img, *pool); }, pool, std::move(owned));
+            } });
+
+        add({ "tiles", "std::thread per call, work-stealing tiles [threads=N, tile=WxH]", [](const RendererOptions& o) {
+            int n = get_threads(o);
+            int tw = 64, th = 64;
+            o.get_size("tile", tw, th);
+            return std::make_unique<FunctionRenderer>("tiles", [n, tw, th](Image& img) { render_cpu_tiles(img, n, tw, th); });
+            } });
+
+        add({ "tiles_pool", "work-stealing tiles on a persistent pool [threads=N, tile=WxH]", [](const RendererOptions& o) {
+            auto owned = o.has("threads") ? std::make_unique<ThreadPool>(get_threads(o)) : nullptr;
+            ThreadPool* pool = owned ? owned.get() : &default_thread_pool();
+            int tw = 64, th = 64;
+            o.get_size("tile", tw, th);
+            return std::make_unique<FunctionRenderer>("tiles_pool", [pool, tw, th](Image& img) { render_cpu_tiles(img, *pool, tw, th); }, pool, std::move(owned));
+            } });
+
+#ifdef _OPENMP
+        add({ "openmp", "OpenMP parallel for over rows", [](const RendererOptions&) {
+            return std::make_unique<FunctionRenderer>("openmp", [](Image& img) { render_cpu_openmp(img); });
+            } });
+#endif
+    }
+};
+
+// Static registration from any translation unit: 'static RendererRegistration reg_cuda({ "cuda", "...", factory });'
+struct RendererRegistration {
+    explicit RendererRegistration(RendererInfo info) { RendererRegistry::instance().add(std::move(info)); }
+};
+
+// Names, one per line with descriptions, for --list
+inline void print_renderers(std::ostream& out, const RendererRegistry& registry = RendererRegistry::instance()) {
+    for (const RendererInfo* info : registry.list()) out << "  " << info->name << " - " << info->description << "\n";
+}
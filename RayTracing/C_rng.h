@@ -0,0 +1,205 @@
+// C_rng.h
+#pragma once
+#include <cstdint>
+#include <cstddef>      // size_t
+#include "C_cpu_features.h"
+#ifdef RT_X86
+#include <immintrin.h>  // SSE2 / AVX2 / AVX-512 intrinsics
+#endif
+
+// Parallel Programming
+// Random numbers for sampling (anti-aliasing jitter, Monte Carlo paths) without any generator state shared between threads
+// A stateful generator (rand(), one std::mt19937) is a contention point, and with rows/tiles handed out dynamically (C_render_cpu_threads.h, C_tile_scheduler.h)
+// which pixel gets which numbers would depend on thread timing, so the image would change from run to run
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11) is counter-based: the output is a pure function of (counter, key)
+    // counter = (pixel x, pixel y, sample index, dimension / 4), key = 64-bit seed
+    // each call returns 4 independent 32-bit words, so dimensions 4k .. 4k+3 of one sample come from the same call
+// The same pixel/sample/dimension gives the same number on any thread, in any order, at any thread count, on any machine, so
+// images are bit-identical across schedulers (golden-image tests) and a frame can be split into regions rendered on different machines
+// The span kernels compute one counter per pixel for a run of pixels in a row, 4/8/16 lanes at a time; they are in the dispatch table (C_cpu_dispatch.h) as rng_span
+
+struct RngKey {
+    uint32_t k0, k1;
+};
+
+inline RngKey make_rng_key(uint64_t seed) {
+    return { uint32_t(seed), uint32_t(seed >> 32) };
+}
+
+// Philox4x32 constants: round multipliers and the Weyl sequence that bumps the key between rounds
+constexpr uint32_t kPhiloxM0 = 0xD2511F53u, kPhiloxM1 = 0xCD9E8D57u;
+constexpr uint32_t kPhiloxW0 = 0x9E3779B9u, kPhiloxW1 = 0xBB67AE85u;
+constexpr int kPhiloxRounds = 10;
+
+// One block: 4 counter words in, 4 random words out (in place)
+inline void philox4x32(uint32_t c[4], RngKey key) {
+    uint32_t k0 = key.k0, k1 = key.k1;
+    for (int r = 0; r < kPhiloxRounds; ++r) {
+        const uint64_t p0 = uint64_t(kPhiloxM0) * c[0];
+        const uint64_t p1 = uint64_t(kPhiloxM1) * c[2];
+        const uint32_t n0 = uint32_t(p1 >> 32) ^ c[1] ^ k0;
+        const uint32_t n2 = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+        c[1] = uint32_t(p1);
+        c[3] = uint32_t(p0);
+        c[0] = n0;
+        c[2] = n2;
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+}
+
+// Word 'dim' of pixel (x, y), sample 'sample'
+inline uint32_t rng_u32(RngKey key, uint32_t x, uint32_t y, uint32_t sample, uint32_t dim) {
+    uint32_t c[4] = { x, y, sample, dim >> 2 };
+    philox4x32(c, key);
+    return c[dim & 3];
+}
+
+// 24 high bits -> float in [0, 1); every value is exactly representable, and 1.0f is never returned
+inline float rng_u01(uint32_t u) { return float(u >> 8) * (1.0f / 16777216.0f); }
+
+// 53 bits from two words -> double in [0, 1)
+inline double rng_u01d(uint32_t hi, uint32_t lo) { return double((uint64_t(hi) << 21) ^ (lo >> 11)) * (1.0 / 9007199254740992.0); }
+
+// Sequential view of one pixel sample: dimension 0, 1, 2, ... in order, one Philox call per 4 dimensions
+// Cheap to construct (no state beyond the counter), so create one per pixel sample on the stack
+class PixelRng {
+public:
+    PixelRng(RngKey key, uint32_t x, uint32_t y, uint32_t sample, uint32_t first_dim = 0) : key_(key), x_(x), y_(y), sample_(sample), dim_(first_dim) {}
+
+    uint32_t next_u32() {
+        if ((dim_ & 3) == 0 || !cached_) refill();
+        return block_[dim_++ & 3];
+    }
+
+    float next_float() { return rng_u01(next_u32()); }
+    double next_double() { uint32_t hi = next_u32(); return rng_u01d(hi, next_u32()); }
+
+    uint32_t dimension() const { return dim_; }
+    void skip_to(uint32_t dim) { dim_ = dim; cached_ = false; }     // e.g. reserve dimensions 0-1 for the pixel jitter and start a path at 2
+
+private:
+    RngKey key_;
+    uint32_t x_, y_, sample_, dim_;
+    uint32_t block_[4] = {};
+    bool cached_ = false;
+
+    void refill() {
+        block_[0] = x_; block_[1] = y_; block_[2] = sample_; block_[3] = dim_ >> 2;
+        philox4x32(block_, key_);
+        cached_ = true;
+    }
+};
+
+
+// Batch API: word 'dim' for pixels (x0 + k, y), k = 0 .. n-1, all at the same sample, written to out[k]
+// The vector kernels run one Philox block per lane; the 32 x 32 -> 64-bit multiply is _mm*_mul_epu32 on the even lanes plus a second one on the odd lanes shifted down
+using RngSpanFn = void (*)(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, uint32_t* out);
+
+inline void rng_span_scalar(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, uint32_t* out) {
+    for (int k = 0; k < n; ++k) out[k] = rng_u32(key, x0 + uint32_t(k), y, sample, dim);
+}
+
+// Floats in [0, 1) for a span, through the given kernel, 256 words at a time through a stack buffer
+inline void rng_uniform_span(RngSpanFn kernel, RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, float* out) {
+    uint32_t bits[256];
+    for (int k0 = 0; k0 < n; k0 += 256) {
+        const int m = n - k0 < 256 ? n - k0 : 256;
+        kernel(key, x0 + uint32_t(k0), y, m, sample, dim, bits);
+        for (int k = 0; k < m; ++k) out[k0 + k] = rng_u01(bits[k]);
+    }
+}
+
+#ifdef RT_X86
+// SSE2: 4 pixels per block of registers; lo/hi halves are put back together with and/or since blend needs SSE4.1
+inline void rng_span_sse2(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, uint32_t* out) {
+    const __m128i m0 = _mm_set1_epi32(int(kPhiloxM0)), m1 = _mm_set1_epi32(int(kPhiloxM1));
+    const __m128i lo_mask = _mm_set1_epi64x(0xFFFFFFFFll), hi_mask = _mm_set1_epi64x(int64_t(0xFFFFFFFF00000000ull));
+    const __m128i step = _mm_setr_epi32(0, 1, 2, 3);
+    const int word = int(dim & 3);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128i c0 = _mm_add_epi32(_mm_set1_epi32(int(x0 + uint32_t(k))), step);
+        __m128i c1 = _mm_set1_epi32(int(y)), c2 = _mm_set1_epi32(int(sample)), c3 = _mm_set1_epi32(int(dim >> 2));
+        uint32_t k0 = key.k0, k1 = key.k1;
+        for (int round = 0; round < kPhiloxRounds; ++round) {
+            __m128i e0 = _mm_mul_epu32(c0, m0), o0 = _mm_mul_epu32(_mm_srli_epi64(c0, 32), m0);
+            __m128i e1 = _mm_mul_epu32(c2, m1), o1 = _mm_mul_epu32(_mm_srli_epi64(c2, 32), m1);
+            __m128i lo0 = _mm_or_si128(_mm_and_si128(e0, lo_mask), _mm_slli_epi64(o0, 32));
+            __m128i hi0 = _mm_or_si128(_mm_srli_epi64(e0, 32), _mm_and_si128(o0, hi_mask));
+            __m128i lo1 = _mm_or_si128(_mm_and_si128(e1, lo_mask), _mm_slli_epi64(o1, 32));
+            __m128i hi1 = _mm_or_si128(_mm_srli_epi64(e1, 32), _mm_and_si128(o1, hi_mask));
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(int(k0)));
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(int(k1)));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+        const __m128i words[4] = { c0, c1, c2, c3 };
+        _mm_storeu_si128((__m128i*)(out + k), words[word]);
+    }
+    rng_span_scalar(key, x0 + uint32_t(k), y, n - k, sample, dim, out + k);
+}
+
+// AVX2: 8 pixels, blend_epi32 merges the even/odd products
+RT_TARGET_AVX2 inline void rng_span_avx2(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, uint32_t* out) {
+    const __m256i m0 = _mm256_set1_epi32(int(kPhiloxM0)), m1 = _mm256_set1_epi32(int(kPhiloxM1));
+    const __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const int word = int(dim & 3);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(int(x0 + uint32_t(k))), step);
+        __m256i c1 = _mm256_set1_epi32(int(y)), c2 = _mm256_set1_epi32(int(sample)), c3 = _mm256_set1_epi32(int(dim >> 2));
+        uint32_t k0 = key.k0, k1 = key.k1;
+        for (int round = 0; round < kPhiloxRounds; ++round) {
+            __m256i e0 = _mm256_mul_epu32(c0, m0), o0 = _mm256_mul_epu32(_mm256_srli_epi64(c0, 32), m0);
+            __m256i e1 = _mm256_mul_epu32(c2, m1), o1 = _mm256_mul_epu32(_mm256_srli_epi64(c2, 32), m1);
+            __m256i lo0 = _mm256_blend_epi32(e0, _mm256_slli_epi64(o0, 32), 0xAA);
+            __m256i hi0 = _mm256_blend_epi32(_mm256_srli_epi64(e0, 32), o0, 0xAA);
+            __m256i lo1 = _mm256_blend_epi32(e1, _mm256_slli_epi64(o1, 32), 0xAA);
+            __m256i hi1 = _mm256_blend_epi32(_mm256_srli_epi64(e1, 32), o1, 0xAA);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int(k0)));
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int(k1)));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+        const __m256i words[4] = { c0, c1, c2, c3 };
+        _mm256_storeu_si256((__m256i*)(out + k), words[word]);
+    }
+    rng_span_sse2(key, x0 + uint32_t(k), y, n - k, sample, dim, out + k);
+}
+
+// AVX-512: 16 pixels, masked moves merge the even/odd products
+RT_TARGET_AVX512 inline void rng_span_avx512(RngKey key, uint32_t x0, uint32_t y, int n, uint32_t sample, uint32_t dim, uint32_t* out) {
+    const __m512i m0 = _mm512_set1_epi32(int(kPhiloxM0)), m1 = _mm512_set1_epi32(int(kPhiloxM1));
+    const __m512i step = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __mmask16 odd = 0xAAAA;
+    const int word = int(dim & 3);
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512i c0 = _mm512_add_epi32(_mm512_set1_epi32(int(x0 + uint32_t(k))), step);
+        __m512i c1 = _mm512_set1_epi32(int(y)), c2 = _mm512_set1_epi32(int(sample)), c3 = _mm512_set1_epi32(int(dim >> 2));
+        uint32_t k0 = key.k0, k1 = key.k1;
+        for (int round = 0; round < kPhiloxRounds; ++round) {
+            __m512i e0 = _mm512_mul_epu32(c0, m0), o0 = _mm512_mul_epu32(_mm512_srli_epi64(c0, 32), m0);
+            __m512i e1 = _mm512_mul_epu32(c2, m1), o1 = _mm512_mul_epu32(_mm512_srli_epi64(c2, 32), m1);
+            __m512i lo0 = _mm512_mask_mov_epi32(e0, odd, _mm512_slli_epi64(o0, 32));
+            __m512i hi0 = _mm512_mask_mov_epi32(_mm512_srli_epi64(e0, 32), odd, o0);
+            __m512i lo1 = _mm512_mask_mov_epi32(e1, odd, _mm512_slli_epi64(o1, 32));
+            __m512i hi1 = _mm512_mask_mov_epi32(_mm512_srli_epi64(e1, 32), odd, o1);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, c1), _mm512_set1_epi32(int(k0)));
+            c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, c3), _mm512_set1_epi32(int(k1)));
+            c1 = lo1;
+            c3 = lo0;
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+        const __m512i words[4] = { c0, c1, c2, c3 };
+        _mm512_storeu_si512((void*)(out + k), words[word]);
+    }
+    rng_span_sse2(key, x0 + uint32_t(k), y, n - k, sample, dim, out + k);
+}
+#endif
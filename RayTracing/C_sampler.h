@@ -0,0 +1,181 @@
+// C_sampler.h
+#pragma once
+#include <cstdint>
+#include <cmath>        // std::sqrt for the stratified grid
+#include <string>
+#include <vector>
+#include <memory>       // std::unique_ptr from make_sampler
+#include <algorithm>    // std::min
+#include "C_rng.h"
+#include "C_sobol.h"
+#include "C_cpu_dispatch.h"     // span kernels for the batch API
+
+// Sampling
+// Where inside a pixel (and, later, in which direction a path bounces) each sample goes
+// Independent random numbers converge as O(1/sqrt(N)) with clumps and holes; low-discrepancy points cover the domain evenly and reach the same noise with several times fewer samples
+// Every sampler here is a pure function sample(x, y, index, dim) -> [0, 1), with no per-thread state, so like C_rng.h results do not depend on threads or scheduling:
+    // independent: Philox (C_rng.h), the reference every other sampler is compared against
+    // stratified:  correlated multi-jittered sampling, an nx x ny = spp grid per dimension pair with spp strata in each dimension too, cells visited in a per-pixel random order
+    // halton:      radical inverse in the d-th prime base, decorrelated between pixels by a per-pixel random shift (Cranley-Patterson rotation)
+    // sobol:       Sobol' (Joe-Kuo direction numbers) with per-pixel Owen scrambling (C_sobol.h); the best of the four for power-of-two sample counts
+// Dimensions are used in pairs for 2D decisions: (0, 1) = position in the pixel, (2, 3) = lens, then 2 per bounce; sample_2d() takes the pair starting at dim
+// The batch API sample_span() fills one dimension of one sample index for a run of pixels in a row; independent and sobol run it through the SIMD kernels of C_cpu_dispatch.h
+
+class Sampler {
+public:
+    virtual ~Sampler() = default;
+
+    virtual std::string name() const = 0;
+
+    // Value in [0, 1) for pixel (x, y), sample 'index' (0 .. samples_per_pixel - 1), dimension 'dim'
+    virtual float sample(uint32_t x, uint32_t y, uint32_t index, uint32_t dim) const = 0;
+
+    // out[k] = sample(x0 + k, y, index, dim), k = 0 .. n-1
+    virtual void sample_span(uint32_t x0, uint32_t y, int n, uint32_t index, uint32_t dim, float* out) const {
+        for (int k = 0; k < n; ++k) out[k] = sample(x0 + uint32_t(k), y, index, dim);
+    }
+
+    void sample_2d(uint32_t x, uint32_t y, uint32_t index, uint32_t dim, float& u, float& v) const {
+        u = sample(x, y, index, dim);
+        v = sample(x, y, index, dim + 1);
+    }
+
+    int samples_per_pixel() const { return spp_; }
+    uint64_t seed() const { return seed_; }
+
+protected:
+    Sampler(int spp, uint64_t seed) : spp_(spp < 1 ? 1 : spp), seed_(seed) {}
+
+    int spp_;
+    uint64_t seed_;
+
+    // Seed word for one dimension, folded into the per-pixel hashes
+    uint32_t dim_seed(uint32_t dim) const { return sampler_pixel_hash(uint32_t(seed_), uint32_t(seed_ >> 32), dim * 0x9E3779B9u); }
+};
+
+class IndependentSampler final : public Sampler {
+public:
+    IndependentSampler(int spp, uint64_t seed) : Sampler(spp, seed), key_(make_rng_key(seed)) {}
+
+    std::string name() const override { return "independent"; }
+
+    float sample(uint32_t x, uint32_t y, uint32_t index, uint32_t dim) const override {
+        return rng_u01(rng_u32(key_, x, y, index, dim));
+    }
+
+    void sample_span(uint32_t x0, uint32_t y, int n, uint32_t index, uint32_t dim, float* out) const override {
+        rng_uniform_span(key_, x0, y, n, index, dim, out);
+    }
+
+private:
+    RngKey key_;
+};
+
+// Kensler's hashed permutation ("Correlated Multi-Jittered Sampling", Pixar 2013): element i of a random permutation of [0, n) chosen by seed p,
+// without storing the permutation; cycle-walks until the value lands inside [0, n)
+inline uint32_t permutation_element(uint32_t i, uint32_t n, uint32_t p) {
+    uint32_t w = n - 1;
+    w |= w >> 1; w |= w >> 2; w |= w >> 4; w |= w >> 8; w |= w >> 16;
+    do {
+        i ^= p; i *= 0xE170893Du; i ^= p >> 16; i ^= (i & w) >> 4;
+        i ^= p >> 8; i *= 0x0929EB3Fu; i ^= p >> 23; i ^= (i & w) >> 1;
+        i *= 1u | (p >> 27); i *= 0x6935FA69u; i ^= (i & w) >> 11; i *= 0x74DCB303u;
+        i ^= (i & w) >> 2; i *= 0x9E501CC3u; i ^= (i & w) >> 2; i *= 0xC860A3DFu;
+        i &= w; i ^= i >> 5;
+    } while (i >= n);
+    return (i + p) % n;
+}
+
+class StratifiedSampler final : public Sampler {
+public:
+    // A grid of exactly nx x ny = spp cells per dimension pair, as square as spp's factors allow (a prime spp gives 1 x spp): a grid with more cells
+    // than samples would leave some rows and columns short of samples, which biases both dimensions
+    StratifiedSampler(int spp, uint64_t seed) : Sampler(spp, seed), key_(make_rng_key(seed ^ 0x5354524154494649ull)) {
+        nx_ = std::max(1, int(std::sqrt(double(spp_))));
+        while (spp_ % nx_ != 0) --nx_;
+        ny_ = spp_ / nx_;
+    }
+
+    std::string name() const override { return "stratified"; }
+
+    // Both dimensions of a pair permute the index the same way, so sample 'index' lands in one cell (cx, cy) of the grid
+    // Inside the cell it is multi-jittered (Kensler's correlated multi-jittering): the first dimension also takes sub-stratum perm(cy) of cx's column,
+    // the second perm(cx) of cy's row, so each dimension on its own has spp strata too, and a 1 x spp grid still stratifies both (a Latin hypercube)
+    // Indices past spp (more samples than planned, e.g. adaptive sampling) fall back to independent jitter
+    float sample(uint32_t x, uint32_t y, uint32_t index, uint32_t dim) const override {
+        const float jitter = rng_u01(rng_u32(key_, x, y, index, dim));
+        if (index >= uint32_t(spp_)) return jitter;
+        const uint32_t pair = dim & ~1u;
+        const uint32_t p = sampler_pixel_hash(x, y, dim_seed(pair));
+        const uint32_t cell = permutation_element(index, uint32_t(spp_), p);
+        const uint32_t nx = uint32_t(nx_), ny = uint32_t(ny_);
+        const uint32_t cx = cell % nx, cy = cell / nx;
+        const uint32_t stratum = (dim & 1u) ? cy * nx + permutation_element(cx, nx, p * 0x63D83595u)
+                                            : cx * ny + permutation_element(cy, ny, p * 0xA511E9B3u);
+        return std::min((float(stratum) + jitter) / float(spp_), 0x1.fffffep-1f);   // keep 1.0 out after the division rounds
+    }
+
+private:
+    RngKey key_;
+    int nx_ = 1, ny_ = 1;
+};
+
+class HaltonSampler final : public Sampler {
+public:
+    HaltonSampler(int spp, uint64_t seed) : Sampler(spp, seed) {}
+
+    std::string name() const override { return "halton"; }
+
+    static constexpr int kDimensions = 32;      // one prime base per dimension; later dimensions reuse them with a different rotation
+
+    float sample(uint32_t x, uint32_t y, uint32_t index, uint32_t dim) const override {
+        const uint32_t shift = sampler_pixel_hash(x, y, dim_seed(dim));
+        const double u = radical_inverse(int(dim % kDimensions), index) + double(shift >> 8) * (1.0 / 16777216.0);
+        return std::min(float(u >= 1.0 ? u - 1.0 : u), 0x1.fffffep-1f);
+    }
+
+    // Digits of index in the given base, mirrored around the radix point: 6 = 110b -> 0.011b = 0.375
+    static double radical_inverse(int base_index, uint32_t index) {
+        static const uint32_t primes[kDimensions] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+                                                     59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131 };
+        if (base_index == 0) return double(reverse_bits32(index)) * (1.0 / 4294967296.0);     // base 2 is a bit reversal
+        const uint32_t base = primes[base_index];
+        const double inv = 1.0 / double(base);
+        uint64_t reversed = 0;
+        double inv_n = 1.0;
+        while (index) {
+            const uint32_t next = index / base;
+            reversed = reversed * base + (index - next * base);
+            inv_n *= inv;
+            index = next;
+        }
+        return double(reversed) * inv_n;
+    }
+};
+
+class SobolSampler final : public Sampler {
+public:
+    SobolSampler(int spp, uint64_t seed) : Sampler(spp, seed) {}
+
+    std::string name() const override { return "sobol"; }
+
+    // Dimensions past the table wrap around to its first dimensions with an independent scramble (padding)
+    float sample(uint32_t x, uint32_t y, uint32_t index, uint32_t dim) const override {
+        return sobol_u01(owen_scramble(sobol_bits(index, int(dim % kSobolDimensions)), sampler_pixel_hash(x, y, dim_seed(dim))));
+    }
+
+    void sample_span(uint32_t x0, uint32_t y, int n, uint32_t index, uint32_t dim, float* out) const override {
+        cpu_kernels().owen_sobol_span(sobol_bits(index, int(dim % kSobolDimensions)), x0, y, n, dim_seed(dim), out);
+    }
+};
+
+// "independent", "stratified", "halton" or "sobol"; nullptr for anything else
+inline std::unique_ptr<Sampler> make_sampler(const std::string& name, int spp, uint64_t seed = 0) {
+    if (name == "independent") return std::make_unique<IndependentSampler>(spp, seed);
+    if (name == "stratified") return std::make_unique<StratifiedSampler>(spp, seed);
+    if (name == "halton") return std::make_unique<HaltonSampler>(spp, seed);
+    if (name == "sobol") return std::make_unique<SobolSampler>(spp, seed);
+    return nullptr;
+}
+
+inline std::vector<std::string> sampler_names() { return { "independent", "stratified", "halton", "sobol" }; }
@@ -0,0 +1,149 @@
+// C_simd_kernels.h
+#pragma once
+#include <cstdint>
+#include <cstddef>      // size_t
+#include "C_cpu_features.h"
+#ifdef RT_X86
+#include <immintrin.h>  // SSE2 / AVX2 / AVX-512 intrinsics
+#endif
+
+// SIMD Optimization
+// Hot per-pixel kernels written once per instruction set, next to the quantization kernels in C_quantize.h; C_cpu_dispatch.h picks one set at startup
+    // pixel generation: the gradient's red channel float(i) / float(nx) is one division per pixel; the vector versions divide 4/8/16 pixels at once
+    // ray generation:   camera ray directions for a run of pixels in a row, written as SoA (x[], y[], z[]); main's one-ray-per-pixel loop uses them
+// Every level uses the same operations in the same order as the scalar reference, and IEEE +, -, *, / and sqrt are exactly rounded, so all levels give bit-identical results
+    // this needs the compiler not to fuse a multiply and an add into one FMA inside the AVX-512 functions (avx512f implies fma): CMake passes -ffp-contract=off to GCC/Clang
+
+// Gradient: writes n interleaved RGB floats for pixels i0 .. i0+n-1 of a row whose flipped index is jj (same formula as every CPU renderer)
+using GradientSpanFn = void (*)(float* rgb, int i0, int n, int jj, int nx, int ny);
+
+// Camera for ray generation: direction of pixel (i, j) = (pixel00 - origin) + i * delta_u + j * delta_v
+struct RayGenParams {
+    float base[3];      // pixel00_loc - camera_center
+    float du[3];        // pixel_delta_u
+    float dv[3];        // pixel_delta_v
+};
+
+// Directions of pixels i0 .. i0+n-1 in row j, written to dx/dy/dz[0 .. n-1]
+using RayGenFn = void (*)(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz);
+
+
+// Scalar reference kernels; the vector ones fall back to these for the tail that does not fill a whole register
+
+inline void gradient_span_scalar(float* rgb, int i0, int n, int jj, int nx, int ny) {
+    const float g = float(jj) / float(ny);
+    for (int k = 0; k < n; ++k) {
+        rgb[3 * k + 0] = float(i0 + k) / float(nx);
+        rgb[3 * k + 1] = g;
+        rgb[3 * k + 2] = 0.2f;
+    }
+}
+
+inline void generate_ray_dirs_scalar(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz) {
+    const float fj = float(j);
+    const float rx = cam.base[0] + fj * cam.dv[0], ry = cam.base[1] + fj * cam.dv[1], rz = cam.base[2] + fj * cam.dv[2];     // start of the row
+    for (int k = 0; k < n; ++k) {
+        float fi = float(i0 + k);
+        dx[k] = rx + fi * cam.du[0];
+        dy[k] = ry + fi * cam.du[1];
+        dz[k] = rz + fi * cam.du[2];
+    }
+}
+
+
+#ifdef RT_X86
+// SSE2 (always present on x86-64)
+
+inline void gradient_span_sse2(float* rgb, int i0, int n, int jj, int nx, int ny) {
+    const float g = float(jj) / float(ny);
+    const __m128 fnx = _mm_set1_ps(float(nx));
+    const __m128i step = _mm_setr_epi32(0, 1, 2, 3);
+    alignas(16) float r[4];
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 fi = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i0 + k), step));
+        _mm_store_ps(r, _mm_div_ps(fi, fnx));
+        for (int q = 0; q < 4; ++q) { rgb[3 * (k + q) + 0] = r[q]; rgb[3 * (k + q) + 1] = g; rgb[3 * (k + q) + 2] = 0.2f; }    // interleave into RGB
+    }
+    gradient_span_scalar(rgb + 3 * k, i0 + k, n - k, jj, nx, ny);
+}
+
+inline void generate_ray_dirs_sse2(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz) {
+    const float fj = float(j);
+    const __m128 rx = _mm_set1_ps(cam.base[0] + fj * cam.dv[0]), ry = _mm_set1_ps(cam.base[1] + fj * cam.dv[1]), rz = _mm_set1_ps(cam.base[2] + fj * cam.dv[2]);
+    const __m128 ux = _mm_set1_ps(cam.du[0]), uy = _mm_set1_ps(cam.du[1]), uz = _mm_set1_ps(cam.du[2]);
+    const __m128i step = _mm_setr_epi32(0, 1, 2, 3);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 fi = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i0 + k), step));
+        _mm_storeu_ps(dx + k, _mm_add_ps(rx, _mm_mul_ps(fi, ux)));
+        _mm_storeu_ps(dy + k, _mm_add_ps(ry, _mm_mul_ps(fi, uy)));
+        _mm_storeu_ps(dz + k, _mm_add_ps(rz, _mm_mul_ps(fi, uz)));
+    }
+    generate_ray_dirs_scalar(cam, j, i0 + k, n - k, dx + k, dy + k, dz + k);
+}
+
+
+// AVX2
+
+RT_TARGET_AVX2 inline void gradient_span_avx2(float* rgb, int i0, int n, int jj, int nx, int ny) {
+    const float g = float(jj) / float(ny);
+    const __m256 fnx = _mm256_set1_ps(float(nx));
+    const __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    alignas(32) float r[8];
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 fi = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i0 + k), step));
+        _mm256_store_ps(r, _mm256_div_ps(fi, fnx));
+        for (int q = 0; q < 8; ++q) { rgb[3 * (k + q) + 0] = r[q]; rgb[3 * (k + q) + 1] = g; rgb[3 * (k + q) + 2] = 0.2f; }
+    }
+    gradient_span_sse2(rgb + 3 * k, i0 + k, n - k, jj, nx, ny);
+}
+
+RT_TARGET_AVX2 inline void generate_ray_dirs_avx2(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz) {
+    const float fj = float(j);
+    const __m256 rx = _mm256_set1_ps(cam.base[0] + fj * cam.dv[0]), ry = _mm256_set1_ps(cam.base[1] + fj * cam.dv[1]), rz = _mm256_set1_ps(cam.base[2] + fj * cam.dv[2]);
+    const __m256 ux = _mm256_set1_ps(cam.du[0]), uy = _mm256_set1_ps(cam.du[1]), uz = _mm256_set1_ps(cam.du[2]);
+    const __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 fi = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i0 + k), step));
+        _mm256_storeu_ps(dx + k, _mm256_add_ps(rx, _mm256_mul_ps(fi, ux)));
+        _mm256_storeu_ps(dy + k, _mm256_add_ps(ry, _mm256_mul_ps(fi, uy)));
+        _mm256_storeu_ps(dz + k, _mm256_add_ps(rz, _mm256_mul_ps(fi, uz)));
+    }
+    generate_ray_dirs_sse2(cam, j, i0 + k, n - k, dx + k, dy + k, dz + k);
+}
+
+
+// AVX-512
+
+RT_TARGET_AVX512 inline void gradient_span_avx512(float* rgb, int i0, int n, int jj, int nx, int ny) {
+    const float g = float(jj) / float(ny);
+    const __m512 fnx = _mm512_set1_ps(float(nx));
+    const __m512i step = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    alignas(64) float r[16];
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512 fi = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(i0 + k), step));
+        _mm512_store_ps(r, _mm512_div_ps(fi, fnx));
+        for (int q = 0; q < 16; ++q) { rgb[3 * (k + q) + 0] = r[q]; rgb[3 * (k + q) + 1] = g; rgb[3 * (k + q) + 2] = 0.2f; }
+    }
+    gradient_span_sse2(rgb + 3 * k, i0 + k, n - k, jj, nx, ny);
+}
+
+RT_TARGET_AVX512 inline void generate_ray_dirs_avx512(const RayGenParams& cam, int j, int i0, int n, float* dx, float* dy, float* dz) {
+    const float fj = float(j);
+    const __m512 rx = _mm512_set1_ps(cam.base[0] + fj * cam.dv[0]), ry = _mm512_set1_ps(cam.base[1] + fj * cam.dv[1]), rz = _mm512_set1_ps(cam.base[2] + fj * cam.dv[2]);
+    const __m512 ux = _mm512_set1_ps(cam.du[0]), uy = _mm512_set1_ps(cam.du[1]), uz = _mm512_set1_ps(cam.du[2]);
+    const __m512i step = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512 fi = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(i0 + k), step));
+        _mm512_storeu_ps(dx + k, _mm512_add_ps(rx, _mm512_mul_ps(fi, ux)));
+        _mm512_storeu_ps(dy + k, _mm512_add_ps(ry, _mm512_mul_ps(fi, uy)));
+        _mm512_storeu_ps(dz + k, _mm512_add_ps(rz, _mm512_mul_ps(fi, uz)));
+    }
+    generate_ray_dirs_sse2(cam, j, i0 + k, n - k, dx + k, dy + k, dz + k);
+}
+#endif
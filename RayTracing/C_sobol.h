@@ -0,0 +1,206 @@
+// C_sobol.h
+#pragma once
+#include <cstdint>
+#include "C_cpu_features.h"
+#ifdef RT_X86
+#include <immintrin.h>  // AVX2 / AVX-512 intrinsics
+#endif
+
+// Sampling
+// Sobol' low-discrepancy sequence with Owen scrambling, the core of the "sobol" sampler in C_sampler.h
+// Sobol' point i in dimension d is the XOR of the generator-matrix columns C_d[j] for every set bit j of i, read as a binary fraction (radix-2, so it is all integer bit math)
+// The columns come from the direction numbers of Joe & Kuo ("Constructing Sobol sequences with better two-dimensional projections", SIAM J. Sci. Comput. 2008,
+// file new-joe-kuo-6.21201), the standard table: each dimension has a primitive polynomial over GF(2) and initial odd integers m_1 .. m_s
+// Plain Sobol' gives every pixel the same points, which shows up as structured aliasing; Owen scrambling randomly flips/permutes the binary digits of each point
+// with a per-pixel seed, which keeps the stratification of the unscrambled points (dimensions 0 and 1 stay a (0,2)-sequence) while decorrelating pixels
+// The scramble is the hash-based approximation of Laine & Karras ("Stratified sampling for stochastic transparency", 2011), in the form used by pbrt-v4:
+// a few multiplies and xors on the bit-reversed value, each of which only lets a bit affect the bits below it, exactly Owen's nested structure
+// The batch kernels scramble one Sobol' point (same sample index and dimension) for a run of pixels: the point is computed once and only the
+// per-pixel hash and scramble run per lane, 8 (AVX2) or 16 (AVX-512) pixels at a time; they are in the dispatch table (C_cpu_dispatch.h) as owen_sobol_span
+
+constexpr int kSobolDimensions = 21;        // dimension 0 (van der Corput) + the first 20 rows of the Joe-Kuo table; the sampler pads past this with fresh scrambles
+constexpr int kSobolBits = 32;
+
+// Joe-Kuo rows for dimensions 1..20: degree s, polynomial coefficients a (inner bits), initial direction numbers m_1..m_s
+struct SobolPolynomial {
+    uint32_t s, a;
+    uint32_t m[7];
+};
+
+inline const SobolPolynomial* sobol_joe_kuo_table() {
+    static const SobolPolynomial table[kSobolDimensions - 1] = {
+        { 1, 0,  { 1 } },
+        { 2, 1,  { 1, 3 } },
+        { 3, 1,  { 1, 3, 1 } },
+        { 3, 2,  { 1, 1, 1 } },
+        { 4, 1,  { 1, 1, 3, 3 } },
+        { 4, 4,  { 1, 3, 5, 13 } },
+        { 5, 2,  { 1, 1, 5, 5, 17 } },
+        { 5, 4,  { 1, 1, 5, 5, 5 } },
+        { 5, 7,  { 1, 1, 7, 11, 19 } },
+        { 5, 11, { 1, 1, 5, 1, 1 } },
+        { 5, 13, { 1, 1, 1, 3, 11 } },
+        { 5, 14, { 1, 3, 5, 5, 31 } },
+        { 6, 1,  { 1, 3, 3, 9, 7, 49 } },
+        { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+        { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+        { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+        { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+        { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+        { 7, 1,  { 1, 3, 7, 11, 23, 15, 103 } },
+        { 7, 4,  { 1, 3, 7, 13, 13, 15, 69 } },
+    };
+    return table;
+}
+
+// Generator matrices, column j of dimension d = direction number v_{j+1} = m_{j+1} << (32 - (j+1)); built once from the table
+struct SobolMatrices {
+    uint32_t v[kSobolDimensions][kSobolBits];
+
+    SobolMatrices() {
+        for (int j = 0; j < kSobolBits; ++j) v[0][j] = 1u << (31 - j);     // dimension 0: identity, i.e. the bit-reversed index
+        const SobolPolynomial* table = sobol_joe_kuo_table();
+        for (int d = 1; d < kSobolDimensions; ++d) {
+            const SobolPolynomial& p = table[d - 1];
+            uint32_t m[kSobolBits];
+            for (uint32_t k = 0; k < kSobolBits; ++k) {
+                if (k < p.s) { m[k] = p.m[k]; continue; }
+                // m_k = 2 a_1 m_{k-1} ^ 4 a_2 m_{k-2} ^ ... ^ 2^(s-1) a_(s-1) m_(k-s+1) ^ 2^s m_(k-s) ^ m_(k-s)
+                uint32_t mk = m[k - p.s] ^ (m[k - p.s] << p.s);
+                for (uint32_t q = 1; q < p.s; ++q)
+                    if ((p.a >> (p.s - 1 - q)) & 1u) mk ^= m[k - q] << q;
+                m[k] = mk;
+            }
+            for (int j = 0; j < kSobolBits; ++j) v[d][j] = m[j] << (31 - j);
+        }
+    }
+};
+
+inline const SobolMatrices& sobol_matrices() {
+    static const SobolMatrices matrices;
+    return matrices;
+}
+
+// Unscrambled point: 32-bit binary fraction of sample 'index' in dimension dim (< kSobolDimensions)
+inline uint32_t sobol_bits(uint32_t index, int dim) {
+    const uint32_t* v = sobol_matrices().v[dim];
+    uint32_t x = 0;
+    for (int j = 0; index; index >>= 1, ++j)
+        if (index & 1u) x ^= v[j];
+    return x;
+}
+
+inline uint32_t reverse_bits32(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+// Per-pixel scramble seed from (x, y) and a base that already folds in the user seed and the dimension (murmur3 finalizer)
+inline uint32_t sampler_pixel_hash(uint32_t x, uint32_t y, uint32_t base) {
+    uint32_t h = (x * 0x8DA6B343u) ^ (y * 0xD8163841u) ^ base;
+    h ^= h >> 16; h *= 0x85EBCA6Bu;
+    h ^= h >> 13; h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Owen scramble of a binary fraction: on the reversed bits, each step is a multiply (carries only move up) or an xor/add with the seed,
+// so bit k of the result depends only on bits >= k of the input plus the seed, which is exactly nested per-digit scrambling
+inline uint32_t owen_scramble(uint32_t v, uint32_t seed) {
+    v = reverse_bits32(v);
+    v ^= v * 0x3D20ADEAu;
+    v += seed;
+    v *= (seed >> 16) | 1u;
+    v ^= v * 0x05526C56u;
+    v ^= v * 0x53A22864u;
+    return reverse_bits32(v);
+}
+
+// 24 high bits -> float in [0, 1), same as rng_u01 in C_rng.h
+inline float sobol_u01(uint32_t v) { return float(v >> 8) * (1.0f / 16777216.0f); }
+
+
+// Batch API: out[k] = owen_scramble(bits, sampler_pixel_hash(x0 + k, y, base)) as a float in [0, 1), for the same Sobol' point 'bits'
+using OwenSobolSpanFn = void (*)(uint32_t bits, uint32_t x0, uint32_t y, int n, uint32_t base, float* out);
+
+inline void owen_sobol_span_scalar(uint32_t bits, uint32_t x0, uint32_t y, int n, uint32_t base, float* out) {
+    for (int k = 0; k < n; ++k) out[k] = sobol_u01(owen_scramble(bits, sampler_pixel_hash(x0 + uint32_t(k), y, base)));
+}
+
+#ifdef RT_X86
+// The seed-independent first step (reverse, v ^= v * c) is shared by all lanes and done once in scalar code
+// SSE2 has no 32-bit mullo (that is SSE4.1), so the SSE2 table entry uses the scalar kernel
+
+// Lane-wise reverse_bits32, same 5 swap steps as the scalar one
+#define RT_SWAP_BITS(W, x, s, mask) _mm##W##_or_si##W(_mm##W##_and_si##W(_mm##W##_srli_epi32(x, s), _mm##W##_set1_epi32(int(mask))), _mm##W##_slli_epi32(_mm##W##_and_si##W(x, _mm##W##_set1_epi32(int(mask))), s))
+
+RT_TARGET_AVX2 inline __m256i reverse_bits32_avx2(__m256i v) {
+    v = RT_SWAP_BITS(256, v, 1, 0x55555555u);
+    v = RT_SWAP_BITS(256, v, 2, 0x33333333u);
+    v = RT_SWAP_BITS(256, v, 4, 0x0F0F0F0Fu);
+    v = RT_SWAP_BITS(256, v, 8, 0x00FF00FFu);
+    return _mm256_or_si256(_mm256_srli_epi32(v, 16), _mm256_slli_epi32(v, 16));
+}
+
+RT_TARGET_AVX2 inline void owen_sobol_span_avx2(uint32_t bits, uint32_t x0, uint32_t y, int n, uint32_t base, float* out) {
+    uint32_t r = reverse_bits32(bits);
+    r ^= r * 0x3D20ADEAu;
+    const __m256i pre = _mm256_set1_epi32(int(r));
+    const __m256i yh = _mm256_set1_epi32(int(y * 0xD8163841u ^ base));
+    const __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i x = _mm256_add_epi32(_mm256_set1_epi32(int(x0 + uint32_t(k))), step);
+        __m256i h = _mm256_xor_si256(_mm256_mullo_epi32(x, _mm256_set1_epi32(int(0x8DA6B343u))), yh);
+        h = _mm256_mullo_epi32(_mm256_xor_si256(h, _mm256_srli_epi32(h, 16)), _mm256_set1_epi32(int(0x85EBCA6Bu)));
+        h = _mm256_mullo_epi32(_mm256_xor_si256(h, _mm256_srli_epi32(h, 13)), _mm256_set1_epi32(int(0xC2B2AE35u)));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));      // seed per lane
+        __m256i v = _mm256_add_epi32(pre, h);
+        v = _mm256_mullo_epi32(v, _mm256_or_si256(_mm256_srli_epi32(h, 16), one));
+        v = _mm256_xor_si256(v, _mm256_mullo_epi32(v, _mm256_set1_epi32(0x05526C56)));
+        v = _mm256_xor_si256(v, _mm256_mullo_epi32(v, _mm256_set1_epi32(0x53A22864)));
+        v = reverse_bits32_avx2(v);
+        _mm256_storeu_ps(out + k, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(v, 8)), scale));   // 24 bits fit an int32 and convert exactly
+    }
+    owen_sobol_span_scalar(bits, x0 + uint32_t(k), y, n - k, base, out + k);
+}
+
+RT_TARGET_AVX512 inline __m512i reverse_bits32_avx512(__m512i v) {
+    v = RT_SWAP_BITS(512, v, 1, 0x55555555u);
+    v = RT_SWAP_BITS(512, v, 2, 0x33333333u);
+    v = RT_SWAP_BITS(512, v, 4, 0x0F0F0F0Fu);
+    v = RT_SWAP_BITS(512, v, 8, 0x00FF00FFu);
+    return _mm512_or_si512(_mm512_srli_epi32(v, 16), _mm512_slli_epi32(v, 16));
+}
+#undef RT_SWAP_BITS
+
+RT_TARGET_AVX512 inline void owen_sobol_span_avx512(uint32_t bits, uint32_t x0, uint32_t y, int n, uint32_t base, float* out) {
+    uint32_t r = reverse_bits32(bits);
+    r ^= r * 0x3D20ADEAu;
+    const __m512i pre = _mm512_set1_epi32(int(r));
+    const __m512i yh = _mm512_set1_epi32(int(y * 0xD8163841u ^ base));
+    const __m512i step = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512 scale = _mm512_set1_ps(1.0f / 16777216.0f);
+    int k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m512i x = _mm512_add_epi32(_mm512_set1_epi32(int(x0 + uint32_t(k))), step);
+        __m512i h = _mm512_xor_si512(_mm512_mullo_epi32(x, _mm512_set1_epi32(int(0x8DA6B343u))), yh);
+        h = _mm512_mullo_epi32(_mm512_xor_si512(h, _mm512_srli_epi32(h, 16)), _mm512_set1_epi32(int(0x85EBCA6Bu)));
+        h = _mm512_mullo_epi32(_mm512_xor_si512(h, _mm512_srli_epi32(h, 13)), _mm512_set1_epi32(int(0xC2B2AE35u)));
+        h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+        __m512i v = _mm512_add_epi32(pre, h);
+        v = _mm512_mullo_epi32(v, _mm512_or_si512(_mm512_srli_epi32(h, 16), one));
+        v = _mm512_xor_si512(v, _mm512_mullo_epi32(v, _mm512_set1_epi32(0x05526C56)));
+        v = _mm512_xor_si512(v, _mm512_mullo_epi32(v, _mm512_set1_epi32(0x53A22864)));
+        v = reverse_bits32_avx512(v);
+        _mm512_storeu_ps(out + k, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(v, 8)), scale));
+    }
+    owen_sobol_span_avx2(bits, x0 + uint32_t(k), y, n - k, base, out + k);
+}
+#endif
@@ -0,0 +1,219 @@
+// C_stream_writer.h
+#pragma once
+#include <cstdio>       // FILE*, fopen, fclose
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>       // lock-free queue slots, band progress (C++20 wait/notify)
+#include <thread>       // the dedicated I/O thread
+#include <memory>       // std::unique_ptr for the queue slots
+#include <algorithm>    // std::min, std::max
+#include "C_ppm_writer.h"       // write_ppm_header / write_ppm_rows do the actual formatting and fwrite
+#include "C_tile_scheduler.h"   // Tile
+
+// I/O Optimization
+// Every backend used to render the whole frame and only then write it out, so the disk sat idle during the render and the CPU sat idle during the write
+// StreamWriter writes the PPM while the image is still being rendered:
+    // renderers submit() each finished tile (or row span) into a lock-free multi-producer queue, one push per tile, no locks on the render threads
+    // a dedicated I/O thread drains the queue, counts finished pixels per band (band_rows rows), and writes every band as soon as it and all bands above it are complete,
+    // so the file is always produced in scanline order, and after the last tile only the last band is left to write
+// The pixels live either in a caller-owned full frame (open() with a frame pointer, for backends that already render into an Image)
+// or in a window of window_bands band buffers owned by the writer, reused as bands reach the disk; then peak memory is window_bands * band_rows * width * 3 bytes instead of a whole frame
+// In window mode producers must call wait_band_writable(band) before writing into a band, which blocks while that band's slot still holds an unwritten band
+// render_cpu_tiles_streamed (C_render_cpu_tiles.h) hands out tiles in row-major order so bands complete roughly top to bottom and the window keeps moving
+
+// Bounded multi-producer queue (Vyukov's array queue): each slot has a sequence number that says whose turn it is, so producers
+// claim a position with one CAS on 'tail' and never wait on each other; the single consumer needs no atomics beyond the slot sequence
+template <typename T>
+class MpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_.reset(new Slot[cap]);
+        for (size_t i = 0; i < cap; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Returns false if the queue is full
+    bool try_push(const T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = slots_[pos & mask_];
+            size_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq == pos) {       // slot is free for this position
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = v;
+                    s.seq.store(pos + 1, std::memory_order_release);    // hand it to the consumer
+                    return true;
+                }
+            }
+            else if (seq < pos) return false;   // consumer has not freed this slot yet: full
+            else pos = tail_.load(std::memory_order_relaxed);   // another producer took it, retry with the new tail
+        }
+    }
+
+    // Single consumer only
+    bool try_pop(T& out) {
+        Slot& s = slots_[head_ & mask_];
+        if (s.seq.load(std::memory_order_acquire) != head_ + 1) return false;   // empty
+        out = s.value;
+        s.seq.store(head_ + mask_ + 1, std::memory_order_release);   // free for the producer one lap later
+        ++head_;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{ 0 };     // producers
+    alignas(64) size_t head_ = 0;                   // consumer
+};
+
+class StreamWriter {
+public:
+    int width = 0, height = 0;
+
+    StreamWriter() : queue_(4096) {}
+    ~StreamWriter() { finish(); }
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // Stream from a caller-owned width x height RGB frame (e.g. Image::pixels) that renderers write into directly
+    bool open(const std::string& path, int w, int h, uint8_t* frame, int band_rows = 64, PpmFormat fmt = PpmFormat::P6) {
+        return start(path, w, h, frame, band_rows, 0, fmt);
+    }
+
+    // Stream through window_bands band buffers owned by the writer; renderers write through pixel_ptr() after wait_band_writable()
+    bool open_windowed(const std::string& path, int w, int h, int band_rows = 64, int window_bands = 4, PpmFormat fmt = PpmFormat::P6) {
+        return start(path, w, h, nullptr, band_rows, std::max(1, window_bands), fmt);
+    }
+
+    bool is_open() const { return file_ != nullptr; }
+    int band_rows() const { return band_rows_; }
+    int num_bands() const { return num_bands_; }
+    int bands_written() const { return written_.load(std::memory_order_acquire); }
+
+    // Same contract as Image::pixel_ptr; in window mode (x, y) must be in a band that wait_band_writable() let through
+    inline uint8_t* pixel_ptr(int x, int y) {
+        if (frame_) return frame_ + 3 * (size_t(y) * size_t(width) + size_t(x));
+        const int band = y / band_rows_;
+        return window_.data() + band_bytes() * size_t(band % window_bands_) + 3 * (size_t(y - band * band_rows_) * size_t(width) + size_t(x));
+    }
+
+    // Block until 'band' has a buffer to write into (its slot's previous band is on disk); no-op for a caller-owned frame
+    void wait_band_writable(int band) {
+        if (frame_) return;
+        int w;
+        while (band >= (w = written_.load(std::memory_order_acquire)) + window_bands_) written_.wait(w, std::memory_order_acquire);
+    }
+
+    // A region is final; safe to call from any number of render threads. Spins (yielding) only if the I/O thread is 4096 regions behind
+    void submit(const Tile& region) {
+        while (!queue_.try_push(region)) std::this_thread::yield();
+        pending_.fetch_add(1, std::memory_order_release);
+        pending_.notify_one();
+    }
+
+    void submit_rows(int y0, int y1) { submit({ 0, y0, width, y1 }); }
+
+    // Wait for every band to be written, stop the I/O thread and close the file
+    // Returns false on a write error, or if some pixels were never submitted (those bands are written as they are, so the file still has the full size)
+    bool finish() {
+        if (!file_) return false;
+        closing_.store(true, std::memory_order_release);
+        pending_.fetch_add(1, std::memory_order_release);
+        pending_.notify_one();
+        io_thread_.join();
+        bool ok = ok_ && complete_;
+        if (std::fclose(file_) != 0) ok = false;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    FILE* file_ = nullptr;
+    PpmFormat fmt_ = PpmFormat::P6;
+    uint8_t* frame_ = nullptr;
+    std::vector<uint8_t> window_;
+    int band_rows_ = 64, num_bands_ = 0, window_bands_ = 0;
+    std::vector<int64_t> band_done_;    // submitted pixels per band; only touched by the I/O thread
+    MpscQueue<Tile> queue_;
+    std::thread io_thread_;
+    bool ok_ = true;
+    bool complete_ = true;              // every pixel was submitted before finish()
+    alignas(64) std::atomic<uint32_t> pending_{ 0 };    // bumped per push, the I/O thread sleeps on it
+    alignas(64) std::atomic<int> written_{ 0 };         // bands on disk, producers waiting for a window slot sleep on it
+    std::atomic<bool> closing_{ false };
+
+    size_t band_bytes() const { return size_t(band_rows_) * size_t(width) * 3; }
+    int band_height(int b) const { return std::min(band_rows_, height - b * band_rows_); }
+
+    bool start(const std::string& path, int w, int h, uint8_t* frame, int band_rows, int window_bands, PpmFormat fmt) {
+        finish();
+        if (w <= 0 || h <= 0) return false;
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) return false;
+        width = w;
+        height = h;
+        fmt_ = fmt;
+        frame_ = frame;
+        band_rows_ = std::max(1, band_rows);
+        num_bands_ = (h + band_rows_ - 1) / band_rows_;
+        window_bands_ = std::min(window_bands, num_bands_);
+        window_.assign(frame ? 0 : band_bytes() * window_bands_, 0);
+        band_done_.assign(num_bands_, 0);
+        ok_ = write_ppm_header(file_, fmt_, w, h);
+        complete_ = true;
+        written_.store(0, std::memory_order_relaxed);
+        closing_.store(false, std::memory_order_relaxed);
+        io_thread_ = std::thread([this]() { io_loop(); });
+        return true;
+    }
+
+    // Credit a region's pixels to every band it overlaps
+    void account(const Tile& r) {
+        const int x0 = std::max(0, r.x0), x1 = std::min(width, r.x1);
+        if (x1 <= x0) return;
+        for (int y = std::max(0, r.y0); y < std::min(height, r.y1); ) {
+            const int b = y / band_rows_;
+            const int y_end = std::min(std::min(height, r.y1), (b + 1) * band_rows_);
+            band_done_[b] += int64_t(x1 - x0) * (y_end - y);
+            y = y_end;
+        }
+    }
+
+    // Write consecutive complete bands starting at the first unwritten one
+    void write_ready(bool force) {
+        int b = written_.load(std::memory_order_relaxed);
+        while (b < num_bands_ && (force || band_done_[b] >= int64_t(width) * band_height(b))) {
+            if (ok_) ok_ = write_ppm_rows(file_, fmt_, pixel_ptr(0, b * band_rows_), width, band_height(b));
+            written_.store(++b, std::memory_order_release);
+            written_.notify_all();
+        }
+    }
+
+    void io_loop() {
+        Tile r;
+        for (;;) {
+            uint32_t seen = pending_.load(std::memory_order_acquire);
+            bool got = false;
+            while (queue_.try_pop(r)) { account(r); got = true; }
+            if (got) write_ready(false);
+            if (closing_.load(std::memory_order_acquire)) {
+                while (queue_.try_pop(r)) account(r);
+                write_ready(false);
+                complete_ = written_.load(std::memory_order_relaxed) == num_bands_;
+                if (!complete_) write_ready(true);      // still write the file out to full size; finish() reports the missing pixels
+                return;
+            }
+            pending_.wait(seen, std::memory_order_acquire);
+        }
+    }
+};
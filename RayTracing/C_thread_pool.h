@@ -0,0 +1,90 @@
+// C_thread_pool.h
+#pragma once
+#include <thread>       // std::thread for the long-lived workers
+#include <atomic>       // std::atomic wait/notify (C++20) to park and wake workers
+#include <mutex>        // serializes concurrent callers of run()
+#include <vector>
+#include <algorithm>    // std::max
+#include <cstdint>
+#include <type_traits>  // std::remove_reference_t for the type-erased job pointer
+
+// Parallel Programming
+// A pool of worker threads that is created once and reused by every render call, instead of constructing and joining std::threads per call
+// Creating/joining threads costs tens of microseconds per thread, which is why C_render_cpu_threads.h lost to the baseline on small images (see the notes at the end of C_main.cu)
+// Idle workers are parked in std::atomic::wait (a futex on Linux, WaitOnAddress on Windows), so they use no CPU between frames
+
+// Fork-join model: run(job) calls job(worker_index) once on every worker, including the calling thread as worker 0, and returns when all of them finished
+// Renderers pass a job that keeps pulling work (rows, tiles) until none is left, so one run() = one parallel render
+
+class ThreadPool {
+public:
+    // num_threads counts the calling thread too, so ThreadPool(8) starts 7 extra threads
+    explicit ThreadPool(int num_threads = std::thread::hardware_concurrency()) {
+        num_threads = std::max(1, num_threads);     // hardware_concurrency() may return 0 if it cannot tell
+        threads.reserve(num_threads - 1);
+        for (int w = 1; w < num_threads; ++w) threads.emplace_back([this, w]() { worker_loop(w); });
+    }
+
+    ~ThreadPool() {
+        stop.store(true, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);    // wake everyone up so they can see 'stop' and exit
+        generation.notify_all();
+        for (auto& th : threads) th.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;             // owns threads, so it cannot be copied
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return int(threads.size()) + 1; }     // number of workers, including the caller
+
+    // Run job(worker_index) on all size() workers and block until every call returned
+    // The job is passed by reference through a type-erased pointer, so no std::function allocation happens per frame
+    template <typename F>
+    void run(F&& job) {
+        std::lock_guard<std::mutex> lock(run_mutex);    // one job at a time; a second caller waits for the first to finish
+
+        job_ctx = (void*)&job;
+        job_fn = [](void* ctx, int w) { (*static_cast<std::remove_reference_t<F>*>(ctx))(w); };
+
+        remaining.store(int(threads.size()), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);    // publishes job_ctx/job_fn to the workers
+        generation.notify_all();
+
+        job(0);                                             // the caller works too instead of sleeping
+
+        int r;
+        while ((r = remaining.load(std::memory_order_acquire)) != 0) remaining.wait(r, std::memory_order_acquire);
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex run_mutex;
+
+    void* job_ctx = nullptr;
+    void (*job_fn)(void*, int) = nullptr;
+
+    // Each worker sits on its own copy of the last generation it has seen; bumping 'generation' means "there is a new job"
+    // Both counters get their own cache line so waking workers and finishing workers don't contend on the same line
+    alignas(64) std::atomic<uint64_t> generation{ 0 };
+    alignas(64) std::atomic<int> remaining{ 0 };
+    std::atomic<bool> stop{ false };
+
+    void worker_loop(int w) {
+        uint64_t seen = 0;
+        for (;;) {
+            generation.wait(seen, std::memory_order_acquire);  // park until generation != seen
+            seen = generation.load(std::memory_order_acquire);
+            if (stop.load(std::memory_order_relaxed)) return;
+
+            job_fn(job_ctx, w);
+
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) remaining.notify_one();   // last one out wakes the caller
+        }
+    }
+};
+
+// Process-wide pool with one worker per hardware thread, created on first use and shared by every renderer that is not handed a pool explicitly
+inline ThreadPool& default_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,96 @@
+// C_tile_scheduler.h
+#pragma once
+#include <atomic>       // std::atomic for lock-free per-worker queues
+#include <cstdint>      // uint64_t to pack a [begin, end) range into one atomic word
+#include <vector>
+#include <algorithm>    // std::min
+
+// Parallel Programming
+// Splits an image into 2D tiles and hands them out to worker threads through per-worker queues with work stealing
+// Compared to the single shared row counter in C_render_cpu_threads.h:
+    // each worker mostly touches its own queue (its own cache line), so there is no single hot atomic that every thread fights over
+    // tiles are small squares instead of full rows, so an expensive region of the image is split across several workers
+    // a worker that runs out of tiles "steals" half of the remaining tiles of another worker, so nobody sits idle while work remains
+
+// Rectangular region of the image [x0, x1) x [y0, y1) in Image (row 0 = top) coordinates
+struct Tile {
+    int x0, y0, x1, y1;
+};
+
+// Cut a width x height image into tiles of (at most) tile_w x tile_h, in row-major order (left->right, top->bottom)
+// Edge tiles are clipped to the image, so they can be smaller than tile_w x tile_h
+inline std::vector<Tile> make_tiles(int width, int height, int tile_w, int tile_h) {
+    tile_w = std::max(1, tile_w);
+    tile_h = std::max(1, tile_h);
+    std::vector<Tile> tiles;
+    tiles.reserve(size_t((width + tile_w - 1) / tile_w) * ((height + tile_h - 1) / tile_h));
+    for (int y = 0; y < height; y += tile_h)
+        for (int x = 0; x < width; x += tile_w)
+            tiles.push_back({ x, y, std::min(x + tile_w, width), std::min(y + tile_h, height) });
+    return tiles;
+}
+
+class TileScheduler {
+public:
+    // Give each of num_workers workers a contiguous block of the num_tiles tile indices; contiguous blocks keep neighbouring tiles on the same core
+    TileScheduler(int num_tiles, int num_workers) : queues(std::max(1, num_workers)) {
+        const int n = int(queues.size());
+        for (int w = 0; w < n; ++w) {
+            uint32_t b = uint32_t(int64_t(num_tiles) * w / n);
+            uint32_t e = uint32_t(int64_t(num_tiles) * (w + 1) / n);
+            queues[w].range.store(pack(b, e), std::memory_order_relaxed);
+        }
+    }
+
+    int num_workers() const { return int(queues.size()); }
+
+    // Claim the next tile for this worker; returns false once every queue is empty (all tiles have been handed out)
+    bool next(int worker, int& tile) {
+        if (pop_front(queues[worker], tile)) return true;   // fast path: own queue, front end
+        return steal(worker, tile);                         // own queue empty: take work from someone else
+    }
+
+private:
+    // One queue per worker; the remaining tiles are the range [begin, end) packed into 64 bits so both ends update with a single CAS
+    // alignas(64) puts each queue on its own cache line so workers don't invalidate each other's queues (false sharing)
+    struct alignas(64) Queue {
+        std::atomic<uint64_t> range{ 0 };
+    };
+    std::vector<Queue> queues;
+
+    static uint64_t pack(uint32_t b, uint32_t e) { return (uint64_t(b) << 32) | e; }
+    static uint32_t begin_of(uint64_t r) { return uint32_t(r >> 32); }
+    static uint32_t end_of(uint64_t r) { return uint32_t(r); }
+
+    // Owner takes from the front; compare_exchange retries only if a thief changed the range at the same time
+    static bool pop_front(Queue& q, int& tile) {
+        uint64_t r = q.range.load(std::memory_order_relaxed);
+        while (begin_of(r) < end_of(r)) {
+            if (q.range.compare_exchange_weak(r, pack(begin_of(r) + 1, end_of(r)), std::memory_order_relaxed)) {
+                tile = int(begin_of(r));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Visit the other workers round-robin and steal the back half of the first non-empty queue
+    // The thief keeps the first stolen tile and puts the rest into its own (empty) queue, where others can steal from it in turn
+    bool steal(int thief, int& tile) {
+        const int n = int(queues.size());
+        for (int k = 1; k < n; ++k) {
+            Queue& victim = queues[(thief + k) % n];
+            uint64_t r = victim.range.load(std::memory_order_relaxed);
+            while (begin_of(r) < end_of(r)) {
+                uint32_t b = begin_of(r), e = end_of(r);
+                uint32_t mid = b + (e - b) / 2;             // victim keeps [b, mid), thief takes [mid, e)
+                if (victim.range.compare_exchange_weak(r, pack(b, mid), std::memory_order_relaxed)) {
+                    tile = int(mid);
+                    queues[thief].range.store(pack(mid + 1, e), std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
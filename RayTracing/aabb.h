@@ -0,0 +1,88 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "vec3.h"
+#include "ray.h"
+
+#include <algorithm>    // std::min, std::max, std::swap
+#include <limits>
+
+/*
+aabb is an axis-aligned bounding box, stored as its minimum and maximum corners.
+Boxes are what a bounding volume hierarchy (bvh.h) tests rays against before it tests the primitives inside them:
+if a ray misses the box, it misses everything in it.
+A default-constructed box is "empty" (lo = +inf, hi = -inf), so growing it by any point or box gives exactly that point or box.
+*/
+
+class aabb {
+public:
+    point3 lo, hi;       // minimum and maximum corners
+
+    aabb()
+        : lo(std::numeric_limits<real>::infinity(), std::numeric_limits<real>::infinity(), std::numeric_limits<real>::infinity()),
+          hi(-std::numeric_limits<real>::infinity(), -std::numeric_limits<real>::infinity(), -std::numeric_limits<real>::infinity()) {}
+
+    aabb(const point3& min_corner, const point3& max_corner) : lo(min_corner), hi(max_corner) {}
+
+    // Enlarge the box so it also contains point p / box b
+    void grow(const point3& p) {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], p[a]);
+            hi[a] = std::max(hi[a], p[a]);
+        }
+    }
+
+    void grow(const aabb& b) {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], b.lo[a]);
+            hi[a] = std::max(hi[a], b.hi[a]);
+        }
+    }
+
+    bool empty() const { return lo.x() > hi.x() || lo.y() > hi.y() || lo.z() > hi.z(); }
+
+    point3 centroid() const { return 0.5 * (lo + hi); }
+    vec3 extent() const { return hi - lo; }
+
+    // Surface area drives the Surface Area Heuristic: a random ray hits a convex box with probability proportional to its surface area
+    // Returned as double even in a float build: SAH costs sum many of these, and that arithmetic is not on the per-ray path
+    double surface_area() const {
+        if (empty()) return 0.0;
+        vec3 d = extent();
+        return 2.0 * (double(d.x()) * d.y() + double(d.y()) * d.z() + double(d.z()) * d.x());
+    }
+
+    // 0 = x, 1 = y, 2 = z
+    int longest_axis() const {
+        vec3 d = extent();
+        if (d.x() > d.y()) return d.x() > d.z() ? 0 : 2;
+        return d.y() > d.z() ? 1 : 2;
+    }
+
+    // Slab test: intersect the ray with the three pairs of parallel planes and check that the three [t_near, t_far] intervals overlap
+    // inv_dir = 1 / direction is passed in because traversal tests many boxes with the same ray; dividing once per ray saves a division per box
+    bool hit(const point3& origin, const vec3& inv_dir, real ray_tmin, real ray_tmax) const {
+        for (int a = 0; a < 3; a++) {
+            real t0 = (lo[a] - origin[a]) * inv_dir[a];
+            real t1 = (hi[a] - origin[a]) * inv_dir[a];
+            if (t0 > t1) std::swap(t0, t1);         // ray travelling in the negative direction enters through the max plane
+            ray_tmin = t0 > ray_tmin ? t0 : ray_tmin;
+            ray_tmax = t1 < ray_tmax ? t1 : ray_tmax;
+            if (ray_tmax < ray_tmin) return false;
+        }
+        return true;
+    }
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax) const {
+        const vec3& d = r.direction();
+        return hit(r.origin(), vec3(real(1) / d.x(), real(1) / d.y(), real(1) / d.z()), ray_tmin, ray_tmax);
+    }
+};
+
+inline aabb surrounding_box(const aabb& a, const aabb& b) {
+    aabb box = a;
+    box.grow(b);
+    return box;
+}
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable.h"
+#include "sphere.h"
+#include "aabb.h"
+
+#include <algorithm>    // std::partition, std::nth_element, std::swap
+#include <utility>      // std::move
+#include <vector>
+
+/*
+Bounding volume hierarchy (BVH): a binary tree of boxes over the scene's primitives.
+A ray only descends into boxes it actually hits, so it tests O(log n) primitives instead of all n (see hittable_list.h for the linear version).
+
+Build: top-down binned Surface Area Heuristic (SAH).
+    For every node, primitive centroids are dropped into a few bins along each axis, and every bin boundary is a candidate split plane.
+    The SAH estimates the cost of a split as
+        C = C_trav + C_isect * (SA(left) * N(left) + SA(right) * N(right)) / SA(parent)
+    (a ray that hits the parent hits a child with probability SA(child)/SA(parent)); the cheapest plane wins, or the node becomes a leaf
+    if not splitting is cheaper. Binning makes each level O(n) instead of sorting the primitives along every axis.
+
+Layout: nodes live in one flat array in depth-first order.
+    An interior node's left child is always the next node in the array, so each node stores only the index of its right child.
+    A leaf stores the range of primitives it holds; primitives are reordered so every leaf's primitives are contiguous.
+    The flat array replaces a tree of heap-allocated nodes with pointers, so traversal walks memory that is mostly sequential.
+
+Traversal: iterative with a small explicit stack instead of recursion.
+    The nearer child (by the ray's direction along the node's split axis) is visited first, so the closest hit is usually found early
+    and far-away boxes are culled by the shrinking t_max.
+*/
+
+struct bvh_node {
+    aabb bbox;
+    int left_first;     // interior: index of the right child (left child is this index + 1); leaf: index of the first primitive
+    int count;          // leaf: number of primitives; interior: 0
+    int axis;           // interior: axis the node was split on, used to visit the nearer child first
+};
+
+struct bvh_build_options {
+    int max_leaf_size = 4;          // nodes with more primitives than this are always split
+    int num_bins = 16;              // candidate split planes per axis = num_bins - 1
+    double traversal_cost = 1.0;    // C_trav, relative cost of testing one node's box
+    double intersection_cost = 1.0; // C_isect, relative cost of testing one primitive
+};
+
+// Deeper than this, splits fall back to the centroid median, which halves the primitive count every level;
+// that bounds the depth (and the traversal stack) even for pathological inputs where SAH keeps peeling off single primitives
+constexpr int kBvhMaxSahDepth = 64;
+constexpr int kBvhStackSize = 128;
+
+struct bvh_stats {
+    int node_count = 0;
+    int leaf_count = 0;
+    int max_depth = 0;
+    double sah_cost = 0.0;          // expected cost of a random ray, in units of C_isect
+};
+
+class bvh_sah_builder {
+public:
+    bvh_sah_builder(const std::vector<aabb>& prim_boxes, const bvh_build_options& opt)
+        : boxes(prim_boxes), options(opt) {
+        options.num_bins = std::max(2, options.num_bins);
+        options.max_leaf_size = std::max(1, options.max_leaf_size);
+        centroids.reserve(boxes.size());
+        for (const aabb& b : boxes) centroids.push_back(b.centroid());
+    }
+
+    // Returns the nodes in depth-first order; prim_order[k] is the index (into prim_boxes) of the k-th primitive in leaf order
+    std::vector<bvh_node> build(std::vector<int>& prim_order) {
+        order = &prim_order;
+        prim_order.resize(boxes.size());
+        for (int i = 0; i < int(boxes.size()); i++) prim_order[i] = i;
+        nodes.clear();
+        nodes.reserve(boxes.empty() ? 0 : 2 * boxes.size() - 1);     // a binary tree over n leaves has at most 2n-1 nodes
+        if (!boxes.empty()) build_range(0, int(boxes.size()), 0);
+        return std::move(nodes);
+    }
+
+    // Build the subtree over prim_order[begin, end) and append its nodes; also used to rebuild a single subtree
+    int build_range(int begin, int end, int depth) {
+        std::vector<int>& ord = *order;
+        int index = int(nodes.size());
+        nodes.push_back({});
+
+        aabb bounds, cbounds;           // bounds of the primitives, and of their centroids
+        for (int k = begin; k < end; k++) {
+            bounds.grow(boxes[ord[k]]);
+            cbounds.grow(centroids[ord[k]]);
+        }
+        nodes[index].bbox = bounds;
+
+        int n = end - begin;
+        if (n == 1) return make_leaf(index, begin, n);
+
+        int axis = -1, split_bin = -1;
+        double best_cost = find_split(begin, end, bounds, cbounds, axis, split_bin);
+        double leaf_cost = options.intersection_cost * n;
+
+        if (n <= options.max_leaf_size && (axis < 0 || best_cost >= leaf_cost)) return make_leaf(index, begin, n);
+
+        int mid = begin;
+        if (axis >= 0 && depth < kBvhMaxSahDepth) {
+            const double cmin = cbounds.lo[axis];
+            const double scale = options.num_bins / (cbounds.hi[axis] - cbounds.lo[axis]);
+            mid = int(std::partition(ord.begin() + begin, ord.begin() + end, [&](int p) {
+                return bin_of(centroids[p][axis], cmin, scale) <= split_bin;
+                }) - ord.begin());
+        }
+        if (mid == begin || mid == end) {
+            // No usable SAH plane (all centroids coincide, rounding put everything on one side, or too deep): split at the median centroid
+            axis = cbounds.longest_axis();
+            mid = begin + n / 2;
+            std::nth_element(ord.begin() + begin, ord.begin() + mid, ord.begin() + end,
+                [&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        build_range(begin, mid, depth + 1);                 // left child lands at index + 1
+        int right = build_range(mid, end, depth + 1);
+        nodes[index].left_first = right;                    // nodes may have reallocated; index, not reference
+        nodes[index].count = 0;
+        nodes[index].axis = axis;
+        return index;
+    }
+
+    std::vector<bvh_node> nodes;
+
+private:
+    const std::vector<aabb>& boxes;
+    std::vector<point3> centroids;
+    std::vector<int>* order = nullptr;
+    bvh_build_options options;
+
+    // Per-bin scratch space for find_split, kept across nodes so the build does not allocate per node
+    std::vector<aabb> bin_box, right_box;
+    std::vector<int> bin_count, right_count;
+
+    int bin_of(double c, double cmin, double scale) const {
+        int b = int((c - cmin) * scale);
+        return b < 0 ? 0 : (b >= options.num_bins ? options.num_bins - 1 : b);
+    }
+
+    int make_leaf(int index, int begin, int n) {
+        nodes[index].left_first = begin;
+        nodes[index].count = n;
+        nodes[index].axis = 0;
+        return index;
+    }
+
+    // Evaluate every bin boundary on every axis; returns the best SAH cost and sets axis/split_bin (axis = -1 if no plane separates anything)
+    double find_split(int begin, int end, const aabb& bounds, const aabb& cbounds, int& best_axis, int& best_bin) {
+        const std::vector<int>& ord = *order;
+        const int nb = options.num_bins;
+        const double parent_area = bounds.surface_area();
+        double best = std::numeric_limits<double>::infinity();
+
+        bin_box.resize(nb);
+        right_box.resize(nb);
+        bin_count.resize(nb);
+        right_count.resize(nb);
+
+        for (int axis = 0; axis < 3; axis++) {
+            double extent = cbounds.hi[axis] - cbounds.lo[axis];
+            if (!(extent > 0)) continue;                    // all centroids on one plane: nothing to split along this axis
+            double scale = nb / extent;
+
+            std::fill(bin_box.begin(), bin_box.end(), aabb());
+            std::fill(bin_count.begin(), bin_count.end(), 0);
+            for (int k = begin; k < end; k++) {
+                int b = bin_of(centroids[ord[k]][axis], cbounds.lo[axis], scale);
+                bin_box[b].grow(boxes[ord[k]]);
+                bin_count[b]++;
+            }
+
+            // Sweep right-to-left to get the box/count of everything right of each boundary, then left-to-right to evaluate the cost
+            aabb acc;
+            int cnt = 0;
+            for (int b = nb - 1; b > 0; b--) {
+                acc.grow(bin_box[b]);
+                cnt += bin_count[b];
+                right_box[b] = acc;
+                right_count[b] = cnt;
+            }
+            acc = aabb();
+            cnt = 0;
+            for (int b = 0; b < nb - 1; b++) {              // split between bin b and bin b+1
+                acc.grow(bin_box[b]);
+                cnt += bin_count[b];
+                if (cnt == 0 || right_count[b + 1] == 0) continue;
+                double cost = options.traversal_cost + options.intersection_cost *
+                    (acc.surface_area() * cnt + right_box[b + 1].surface_area() * right_count[b + 1]) / parent_area;
+                if (cost < best) {
+                    best = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+        return best;
+    }
+};
+
+// Build a BVH over arbitrary primitives given only their bounding boxes
+inline std::vector<bvh_node> build_bvh_sah(const std::vector<aabb>& prim_boxes, std::vector<int>& prim_order,
+                                           const bvh_build_options& opt = {}) {
+    bvh_sah_builder builder(prim_boxes, opt);
+    return builder.build(prim_order);
+}
+
+// Iterative closest-hit traversal; intersect(k, t_max) tests the k-th primitive in leaf order, and on a hit shrinks t_max and returns true
+template <typename Intersect>
+inline bool traverse_bvh(const std::vector<bvh_node>& nodes, const ray& r, real ray_tmin, real& ray_tmax, Intersect&& intersect) {
+    if (nodes.empty()) return false;
+
+    const vec3& d = r.direction();
+    const vec3 inv_dir(real(1) / d.x(), real(1) / d.y(), real(1) / d.z());
+    const bool dir_neg[3] = { d.x() < 0, d.y() < 0, d.z() < 0 };
+
+    int stack[kBvhStackSize];
+    int sp = 0;
+    int index = 0;
+    bool hit_anything = false;
+
+    for (;;) {
+        const bvh_node& node = nodes[index];
+        if (node.bbox.hit(r.origin(), inv_dir, ray_tmin, ray_tmax)) {
+            if (node.count > 0) {
+                for (int k = node.left_first; k < node.left_first + node.count; k++)
+                    if (intersect(k, ray_tmax)) hit_anything = true;
+            }
+            else {
+                int near_child = index + 1, far_child = node.left_first;
+                if (dir_neg[node.axis]) std::swap(near_child, far_child);     // ray runs toward -axis: the right child is nearer
+                stack[sp++] = far_child;
+                index = near_child;
+                continue;
+            }
+        }
+        if (sp == 0) break;
+        index = stack[--sp];
+    }
+    return hit_anything;
+}
+
+// Node count, depth and SAH cost of a built tree (for comparing builders and detecting degradation)
+inline bvh_stats compute_bvh_stats(const std::vector<bvh_node>& nodes, const bvh_build_options& opt = {}) {
+    bvh_stats st;
+    st.node_count = int(nodes.size());
+    if (nodes.empty()) return st;
+    double root_area = nodes[0].bbox.surface_area();
+
+    std::vector<std::pair<int, int>> stack = { { 0, 1 } };     // (node, depth)
+    while (!stack.empty()) {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+        const bvh_node& node = nodes[index];
+        st.max_depth = std::max(st.max_depth, depth);
+        double p = root_area > 0 ? node.bbox.surface_area() / root_area : 1.0;    // probability a ray through the root reaches this node
+        if (node.count > 0) {
+            st.leaf_count++;
+            st.sah_cost += p * opt.intersection_cost * node.count;
+        }
+        else {
+            st.sah_cost += p * opt.traversal_cost;
+            stack.push_back({ index + 1, depth + 1 });
+            stack.push_back({ node.left_first, depth + 1 });
+        }
+    }
+    return st;
+}
+
+// BVH over spheres; spheres are stored by value in leaf order so a leaf's spheres are adjacent in memory
+class bvh : public hittable {
+public:
+    bvh() {}
+
+    explicit bvh(const std::vector<sphere>& objects, const bvh_build_options& opt = {}) {
+        std::vector<aabb> boxes;
+        boxes.reserve(objects.size());
+        for (const sphere& s : objects) boxes.push_back(s.bounding_box());
+
+        std::vector<int> order;
+        nodes = build_bvh_sah(boxes, order, opt);
+        spheres.reserve(objects.size());
+        for (int i : order) spheres.push_back(objects[i]);
+    }
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        return traverse_bvh(nodes, r, ray_tmin, ray_tmax, [&](int k, real& t_max) {
+            if (!spheres[k].hit(r, ray_tmin, t_max, rec)) return false;
+            t_max = rec.t;
+            return true;
+            });
+    }
+
+    aabb bounding_box() const override { return nodes.empty() ? aabb() : nodes[0].bbox; }
+
+    bvh_stats stats(const bvh_build_options& opt = {}) const { return compute_bvh_stats(nodes, opt); }
+
+    std::vector<bvh_node> nodes;
+    std::vector<sphere> spheres;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef BVH_COMPRESSED_H
+#define BVH_COMPRESSED_H
+
+#include "bvh.h"
+#include "bvh_wide.h"   // float_round_down/up, bvh_wide_ray and kBvhWideFarScale: the same conservative float slab test
+
+#include <algorithm>    // std::min, std::max
+#include <bit>          // std::bit_cast
+#include <cmath>        // std::floor, std::ceil, std::signbit
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/*
+Compressed BVH: the binary hierarchy of bvh.h with every node shrunk to 16 bytes by quantizing child boxes to 8 bits.
+
+Why: a bvh_node is 64 bytes in a double build (36 in float), so the hierarchy of a large scene does not fit in L2/L3 and traversal waits on memory.
+At 16 bytes per node the same tree takes a quarter of the space (a bit under half in float), so four times as many nodes fit in each cache level.
+
+Frames: an interior node stores the boxes of its two children as 8-bit offsets inside the node's own box, its "frame". The frame is not stored:
+it is the node's box as decoded from its parent, carried down the traversal stack; only the root frame (the root box rounded outward to float)
+is kept in full precision. Along each axis the frame is cut into 255 cells of size s = a power of two at least (frame extent) / 255, and a child
+bound is decoded as frame_lo + q * s in float. q * s is exact (8-bit q times a power of two), and s is derived from the decoded frame with the
+same float operations during the build and the traversal, so the builder knows exactly which value each code decodes to.
+
+Conservative decoding: the builder picks the largest q whose decoded value is <= the exact lower bound and the smallest q whose decoded value
+is >= the exact upper bound, so every decoded box contains the exact one, and the next level is quantized inside that decoded box. The ray test
+is the robust float slab test of bvh_wide.h, so the compressed tree finds the same closest hits as the binary tree; decoded boxes are at most one
+cell per side larger than exact ones, which costs some extra box entries (compute_bvh_compressed_stats reports how many, as SAH cost).
+
+Layout: node i of the compressed tree is node i of the binary tree it came from (depth-first, left child = i + 1), and leaves keep their
+primitive ranges, so it uses the same primitive order.
+*/
+
+struct alignas(16) bvh_qnode {
+    union {
+        uint8_t child_box[2][6];    // interior: left / right child box in this node's frame, min x, y, z then max x, y, z
+        int first;                  // leaf: first primitive
+    };
+    int ref;                        // interior: index of the right child (> 0); leaf: -(number of primitives)
+};
+static_assert(sizeof(bvh_qnode) == 16, "compressed BVH nodes are 16 bytes");
+
+// Decoded box of a node, in float
+struct bvh_qframe {
+    float lo[3], hi[3];
+};
+
+// Cell size along one axis of a frame: the power of two >= (hi - lo) / 254, rounded up through the exponent bits so it is cheap and deterministic.
+// Dividing by 254 rather than 255 leaves room for the rounding of the subtraction and the multiply, so 255 * s >= hi - lo always holds
+inline float bvh_qframe_scale(float lo, float hi) {
+    const float x = (hi - lo) * (1.0f / 254.0f);
+    return std::bit_cast<float>((std::bit_cast<uint32_t>(x) + 0x7FFFFFu) & 0xFF800000u);
+}
+
+inline float bvh_qdecode(float frame_lo, float scale, uint8_t q) { return frame_lo + float(q) * scale; }
+
+// Largest code whose decoded value is <= v / smallest code whose decoded value is >= v (v lies inside the frame)
+inline uint8_t bvh_quantize_down(double v, float frame_lo, float scale) {
+    if (!(scale > 0)) return 0;
+    int q = int(std::clamp(std::floor((v - frame_lo) / scale), 0.0, 255.0));
+    while (q > 0 && double(bvh_qdecode(frame_lo, scale, uint8_t(q))) > v) --q;
+    while (q < 255 && double(bvh_qdecode(frame_lo, scale, uint8_t(q + 1))) <= v) ++q;
+    return uint8_t(q);
+}
+
+inline uint8_t bvh_quantize_up(double v, float frame_lo, float scale) {
+    if (!(scale > 0)) return 0;
+    int q = int(std::clamp(std::ceil((v - frame_lo) / scale), 0.0, 255.0));
+    while (q < 255 && double(bvh_qdecode(frame_lo, scale, uint8_t(q))) < v) ++q;
+    while (q > 0 && double(bvh_qdecode(frame_lo, scale, uint8_t(q - 1))) >= v) --q;
+    return uint8_t(q);
+}
+
+// Box of child c (0 = left, 1 = right) of an interior node whose own decoded box is frame
+inline bvh_qframe bvh_qdecode_child(const bvh_qnode& node, const bvh_qframe& frame, int c) {
+    bvh_qframe box;
+    for (int a = 0; a < 3; ++a) {
+        const float s = bvh_qframe_scale(frame.lo[a], frame.hi[a]);
+        box.lo[a] = bvh_qdecode(frame.lo[a], s, node.child_box[c][a]);
+        box.hi[a] = bvh_qdecode(frame.lo[a], s, node.child_box[c][3 + a]);
+    }
+    return box;
+}
+
+inline bvh_qframe bvh_qframe_of(const aabb& b) {
+    bvh_qframe f;
+    for (int a = 0; a < 3; ++a) {
+        f.lo[a] = float_round_down(b.lo[a]);
+        f.hi[a] = float_round_up(b.hi[a]);
+    }
+    return f;
+}
+
+// Quantize a binary tree; root_frame receives the root box, the only box stored in full (float) precision
+inline std::vector<bvh_qnode> compress_bvh(const std::vector<bvh_node>& binary, bvh_qframe& root_frame) {
+    std::vector<bvh_qnode> nodes(binary.size());
+    root_frame = {};
+    if (binary.empty()) return nodes;
+
+    // Parents come before their children in depth-first order, so one forward pass sees every frame before it is needed
+    std::vector<bvh_qframe> frames(binary.size());
+    frames[0] = root_frame = bvh_qframe_of(binary[0].bbox);
+    for (size_t i = 0; i < binary.size(); ++i) {
+        const bvh_node& b = binary[i];
+        bvh_qnode& q = nodes[i];
+        if (b.count > 0) {
+            q.first = b.left_first;
+            q.ref = -b.count;
+            continue;
+        }
+        q.ref = b.left_first;
+        const int kids[2] = { int(i) + 1, b.left_first };
+        const bvh_qframe& f = frames[i];
+        for (int c = 0; c < 2; ++c) {
+            const aabb& box = binary[kids[c]].bbox;
+            for (int a = 0; a < 3; ++a) {
+                const float s = bvh_qframe_scale(f.lo[a], f.hi[a]);
+                q.child_box[c][a] = bvh_quantize_down(box.lo[a], f.lo[a], s);
+                q.child_box[c][3 + a] = bvh_quantize_up(box.hi[a], f.lo[a], s);
+            }
+            frames[kids[c]] = bvh_qdecode_child(q, f, c);
+        }
+    }
+    return nodes;
+}
+
+// Robust float slab test of one decoded box (the scalar column of bvh_wide_slab_scalar); returns the entry distance, or +inf on a miss
+inline float bvh_qframe_hit(const bvh_qframe& box, const bvh_wide_ray& r, float tmin, float tmax) {
+    float t0 = tmin, t1 = tmax;
+    for (int a = 0; a < 3; ++a) {
+        const float lo = (box.lo[a] - r.org[a]) * r.inv[a], hi = (box.hi[a] - r.org[a]) * r.inv[a];
+        const bool neg = std::signbit(r.inv[a]);     // a -0.0 component has inv = -inf and must enter at the max plane, like near_row
+        const float tn = (neg ? hi : lo) - r.slack[a];
+        const float tf = ((neg ? lo : hi) + r.slack[a]) * kBvhWideFarScale;
+        t0 = tn > t0 ? tn : t0;     // a NaN distance (0 * inf on a flat box edge) leaves t0 / t1 unchanged
+        t1 = tf < t1 ? tf : t1;
+    }
+    return t0 <= t1 ? t0 : std::numeric_limits<float>::infinity();
+}
+
+// Closest-hit traversal with the same contract as traverse_bvh; each stack entry carries the decoded box of the node it points to
+template <typename Intersect>
+inline bool traverse_bvh_compressed(const std::vector<bvh_qnode>& nodes, const bvh_qframe& root_frame, const ray& r, real ray_tmin, real& ray_tmax,
+                                    Intersect&& intersect) {
+    if (nodes.empty()) return false;
+    const bvh_wide_ray wr(r);
+    const float tmin = float_round_down(double(ray_tmin));
+    if (bvh_qframe_hit(root_frame, wr, tmin, float_round_up(double(ray_tmax))) == std::numeric_limits<float>::infinity()) return false;
+
+    struct entry {
+        int index;
+        float t_near;
+        bvh_qframe frame;
+    };
+    entry stack[kBvhStackSize];
+    int sp = 0;
+    entry cur = { 0, tmin, root_frame };
+    bool hit_anything = false;
+
+    for (;;) {
+        const bvh_qnode& node = nodes[cur.index];
+        if (node.ref < 0) {
+            for (int k = node.first; k < node.first - node.ref; k++)
+                if (intersect(k, ray_tmax)) hit_anything = true;
+        }
+        else {
+            const float tmax = float_round_up(double(ray_tmax));
+            const bvh_qframe left = bvh_qdecode_child(node, cur.frame, 0), right = bvh_qdecode_child(node, cur.frame, 1);
+            const float t_left = bvh_qframe_hit(left, wr, tmin, tmax), t_right = bvh_qframe_hit(right, wr, tmin, tmax);
+            const bool hit_left = t_left != std::numeric_limits<float>::infinity(), hit_right = t_right != std::numeric_limits<float>::infinity();
+            if (hit_left && hit_right) {
+                const bool left_first = t_left <= t_right;
+                stack[sp++] = left_first ? entry{ node.ref, t_right, right } : entry{ cur.index + 1, t_left, left };
+                cur = left_first ? entry{ cur.index + 1, t_left, left } : entry{ node.ref, t_right, right };
+                continue;
+            }
+            if (hit_left || hit_right) {
+                cur = hit_left ? entry{ cur.index + 1, t_left, left } : entry{ node.ref, t_right, right };
+                continue;
+            }
+        }
+        // Next entry, skipping boxes that start beyond the closest hit so far
+        for (;;) {
+            if (sp == 0) return hit_anything;
+            cur = stack[--sp];
+            if (cur.t_near <= ray_tmax) break;
+        }
+    }
+}
+
+// Memory saved and the traversal cost of the looser decoded boxes, next to the exact tree it was compressed from
+struct bvh_compressed_stats {
+    int node_count = 0;
+    size_t bytes = 0;
+    size_t binary_bytes = 0;        // the same tree as bvh_node
+    double sah_cost = 0.0;          // SAH cost with the decoded boxes (units of C_isect, as bvh_stats::sah_cost)
+    double binary_sah_cost = 0.0;   // SAH cost with the exact boxes
+    double mean_area_growth = 0.0;  // mean decoded / exact surface area over all non-root nodes
+};
+
+inline bvh_compressed_stats compute_bvh_compressed_stats(const std::vector<bvh_qnode>& nodes, const bvh_qframe& root_frame,
+                                                         const std::vector<bvh_node>& binary, const bvh_build_options& opt = {}) {
+    bvh_compressed_stats st;
+    st.node_count = int(nodes.size());
+    st.bytes = nodes.size() * sizeof(bvh_qnode);
+    st.binary_bytes = binary.size() * sizeof(bvh_node);
+    st.binary_sah_cost = compute_bvh_stats(binary, opt).sah_cost;
+    if (nodes.empty()) return st;
+
+    auto area = [](const bvh_qframe& f) {
+        const double dx = double(f.hi[0]) - f.lo[0], dy = double(f.hi[1]) - f.lo[1], dz = double(f.hi[2]) - f.lo[2];
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    };
+    std::vector<bvh_qframe> frames(nodes.size());
+    frames[0] = root_frame;
+    const double root_area = area(root_frame);
+    double growth = 0.0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const double p = root_area > 0 ? area(frames[i]) / root_area : 1.0;
+        if (i > 0) {
+            const double exact = binary[i].bbox.surface_area();
+            growth += exact > 0 ? area(frames[i]) / exact : 1.0;
+        }
+        if (nodes[i].ref < 0) {
+            st.sah_cost += p * opt.intersection_cost * -nodes[i].ref;
+            continue;
+        }
+        st.sah_cost += p * opt.traversal_cost;
+        frames[i + 1] = bvh_qdecode_child(nodes[i], frames[i], 0);
+        frames[nodes[i].ref] = bvh_qdecode_child(nodes[i], frames[i], 1);
+    }
+    st.mean_area_growth = nodes.size() > 1 ? growth / double(nodes.size() - 1) : 1.0;
+    return st;
+}
+
+// Compressed BVH over spheres, quantized from a binary bvh (SAH or LBVH) and sharing its leaf order
+class bvh_compressed : public hittable {
+public:
+    bvh_compressed() {}
+
+    explicit bvh_compressed(const bvh& binary) : spheres(binary.spheres), bounds(binary.bounding_box()) {
+        nodes = compress_bvh(binary.nodes, root_frame);
+    }
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        return traverse_bvh_compressed(nodes, root_frame, r, ray_tmin, ray_tmax, [&](int k, real& t_max) {
+            if (!spheres[k].hit(r, ray_tmin, t_max, rec)) return false;
+            t_max = rec.t;
+            return true;
+            });
+    }
+
+    aabb bounding_box() const override { return bounds; }
+
+    // Needs the binary tree this one was compressed from, for the exact boxes
+    bvh_compressed_stats stats(const bvh& binary, const bvh_build_options& opt = {}) const {
+        return compute_bvh_compressed_stats(nodes, root_frame, binary.nodes, opt);
+    }
+
+    std::vector<bvh_qnode> nodes;
+    bvh_qframe root_frame = {};
+    std::vector<sphere> spheres;
+    aabb bounds;
+};
+
+#endif
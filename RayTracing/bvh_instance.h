@@ -0,0 +1,109 @@
+#ifndef BVH_INSTANCE_H
+#define BVH_INSTANCE_H
+
+#include "bvh.h"
+#include "transform.h"
+
+#include <cstddef>
+#include <memory>       // std::shared_ptr: every instance of an asset points at the same bottom-level bvh
+#include <unordered_set>
+#include <utility>      // std::move
+#include <vector>
+
+/*
+Two-level acceleration structure: a top-level BVH over instances, each a reference to a shared bottom-level BVH plus a transform.
+
+Why: a scene made of many copies of a few assets would, flattened into one bvh, store every copy's spheres and nodes again. Here each asset's
+bvh is built once in its own object space and held by std::shared_ptr, and an instance only adds its transform, the cached inverse and its
+world box, so memory grows with the number of assets plus a few hundred bytes per instance instead of with the number of copies.
+
+Traversal: the top level is the ordinary bvh.h node array over the instances' world boxes, traversed with traverse_bvh. An instance the ray
+reaches transforms the ray into object space with its inverse (direction not renormalized, so t means the same in both spaces) and runs the
+bottom-level bvh with the current closest t as its limit; a hit's point is recomputed on the world ray and its normal goes through the inverse
+transpose. Rotations, non-uniform scales and shears all work, since spheres are only ever intersected in their own space.
+*/
+
+class instance final : public hittable {      // final: the top level stores instances by value and calls hit() without a virtual dispatch
+public:
+    instance() {}
+
+    instance(std::shared_ptr<const bvh> object, const affine3& object_to_world)
+        : blas(std::move(object)), to_world(object_to_world), to_object(object_to_world.inverse()),
+          world_box(blas ? object_to_world.apply(blas->bounding_box()) : aabb()) {}
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        if (!blas->hit(to_object.apply(r), ray_tmin, ray_tmax, rec)) return false;
+        rec.p = r.at(rec.t);
+        rec.normal = unit_vector(to_object.transpose_vector(rec.normal));    // still faces against the ray, so front_face stays as it was
+        return true;
+    }
+
+    aabb bounding_box() const override { return world_box; }
+
+    std::shared_ptr<const bvh> blas;    // bottom-level structure, in object space
+    affine3 to_world;
+    affine3 to_object;                  // to_world.inverse(), cached: every ray that reaches the instance needs it
+    aabb world_box;
+};
+
+// Memory of one bottom-level bvh (nodes and spheres)
+inline size_t bvh_memory_bytes(const bvh& tree) {
+    return tree.nodes.size() * sizeof(bvh_node) + tree.spheres.size() * sizeof(sphere);
+}
+
+struct bvh_tlas_stats {
+    int instance_count = 0;
+    int blas_count = 0;             // distinct bottom-level bvhs
+    long long sphere_count = 0;     // spheres in the scene counting every copy
+    size_t bytes = 0;               // top-level nodes + instances + each distinct bottom-level bvh once
+    size_t flattened_bytes = 0;     // every instance's bottom-level bvh once per copy: roughly what one flattened bvh would need
+    bvh_stats top;                  // node count, depth and SAH cost of the top level
+};
+
+// Top-level BVH over instances; instances are stored by value in leaf order, like bvh's spheres
+class bvh_tlas : public hittable {
+public:
+    bvh_tlas() {}
+
+    explicit bvh_tlas(const std::vector<instance>& objects, const bvh_build_options& opt = {}) {
+        std::vector<aabb> boxes;
+        boxes.reserve(objects.size());
+        for (const instance& inst : objects) boxes.push_back(inst.bounding_box());
+
+        std::vector<int> order;
+        nodes = build_bvh_sah(boxes, order, opt);
+        instances.reserve(objects.size());
+        for (int i : order) instances.push_back(objects[i]);
+    }
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        return traverse_bvh(nodes, r, ray_tmin, ray_tmax, [&](int k, real& t_max) {
+            if (!instances[k].hit(r, ray_tmin, t_max, rec)) return false;
+            t_max = rec.t;
+            return true;
+            });
+    }
+
+    aabb bounding_box() const override { return nodes.empty() ? aabb() : nodes[0].bbox; }
+
+    bvh_tlas_stats stats(const bvh_build_options& opt = {}) const {
+        bvh_tlas_stats st;
+        st.instance_count = int(instances.size());
+        st.top = compute_bvh_stats(nodes, opt);
+        st.bytes = nodes.size() * sizeof(bvh_node) + instances.size() * sizeof(instance);
+        std::unordered_set<const bvh*> seen;
+        for (const instance& inst : instances) {
+            const size_t blas_bytes = bvh_memory_bytes(*inst.blas);
+            st.sphere_count += (long long)inst.blas->spheres.size();
+            st.flattened_bytes += blas_bytes;
+            if (seen.insert(inst.blas.get()).second) st.bytes += blas_bytes;
+        }
+        st.blas_count = int(seen.size());
+        return st;
+    }
+
+    std::vector<bvh_node> nodes;
+    std::vector<instance> instances;
+};
+
+#endif
@@ -0,0 +1,545 @@
+#ifndef BVH_LBVH_H
+#define BVH_LBVH_H
+
+#include "bvh.h"
+#include "C_thread_pool.h"
+#include "C_timer.h"
+
+#include <algorithm>    // std::min, std::max, std::clamp, std::fill, std::swap
+#include <atomic>       // arrival counters for the bottom-up passes
+#include <cmath>        // std::abs
+#include <bit>          // std::countl_zero, std::countr_zero, std::popcount
+#include <cstdint>
+#include <limits>
+#include <memory>       // std::unique_ptr for the atomic counter array
+#include <vector>
+
+/*
+Linear BVH (LBVH): a second way to build the same bvh_node array as bvh.h, for scenes that are rebuilt every frame (particles, animation)
+or are too large for the top-down SAH build. Every step is a flat parallel loop on a ThreadPool (the one render_cpu_threads(img, pool) uses):
+
+1. Morton codes. Each primitive's centroid is quantized on a 2^k grid over the scene's centroid bounds and its x/y/z bits are interleaved
+   into one integer, 30 bits (10 per axis) or 63 bits (21 per axis, for dense scenes where 1024 cells per axis put many primitives in one cell).
+   Sorting by that integer orders the primitives along a Z-order curve, so primitives close in the sorted list are close in space.
+2. Sort. Parallel LSD radix sort, 8 bits per pass (4 passes for 30-bit codes, 8 for 63-bit): per-worker histograms of its slice, one prefix sum
+   over (digit, worker), then a stable scatter. Passes where every key has the same digit are skipped.
+3. Hierarchy. The sorted codes implicitly define a radix tree: Karras ("Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees",
+   HPG 2012) shows that internal node i can find its own key range and split point with binary searches over the longest common prefix of
+   neighbouring keys, independent of every other node, so all n-1 internal nodes are built in one parallel loop. Equal codes are told apart by
+   their index in the sorted list.
+4. Bounds. Bottom-up: every leaf walks toward the root, and an atomic counter per node lets only the second child to arrive continue, once both
+   child boxes are final. The same walk accumulates primitive counts and the SAH cost of each subtree.
+5. Treelets (optional). Karras & Aila ("Fast Parallel Construction of High-Quality Bounding Volume Hierarchies", HPG 2013): during the same kind of
+   bottom-up walk, the 7 nodes under a subtree root that have the largest boxes are re-paired into the topology with the lowest SAH cost
+   (dynamic programming over all 2^7 subsets of them). Morton order ignores primitive sizes, so this recovers much of the gap to a full SAH build.
+6. Output. Subtrees that are cheaper as a leaf by the SAH (and hold at most max_leaf_size primitives) are collapsed, and the tree is written
+   as bvh.h's depth-first array; subtree sizes are known, so every node's output slot is known and disjoint subtrees are written in parallel.
+
+The result is a valid bvh_node array for traverse_bvh / compute_bvh_stats, usually with a somewhat higher SAH cost than build_bvh_sah but built
+many times faster. The split axis of an interior node is the axis along which its children's centers are farthest apart (children are ordered
+so the left one is on the negative side), which keeps the nearer-child-first traversal order meaningful.
+*/
+
+struct lbvh_build_options {
+    int morton_bits = 30;           // 30 or 63
+    int max_leaf_size = 4;          // subtrees with at most this many primitives become one leaf when the SAH says that is cheaper
+    int treelet_passes = 0;         // rounds of treelet restructuring; 0 = plain LBVH
+    int treelet_min_prims = 7;      // only subtrees with at least this many primitives are restructured; doubled after every round
+    double traversal_cost = 1.0;    // C_trav, as in bvh_build_options
+    double intersection_cost = 1.0; // C_isect
+};
+
+// Wall time of each build step, for the bench and for deciding whether treelets pay off
+struct lbvh_build_timings {
+    double morton_ms = 0, sort_ms = 0, hierarchy_ms = 0, bounds_ms = 0, treelet_ms = 0, output_ms = 0, total_ms = 0;
+};
+
+constexpr int kLbvhTreeletLeaves = 7;           // 2^7 subsets in the treelet DP, as in the paper
+constexpr int kLbvhSerialCutoff = 4096;         // loops shorter than this run on the calling thread instead of waking the pool
+
+// Keep one builder per dynamic scene and call build() every frame: the scratch arrays and the output keep their capacity,
+// so after the first frame a rebuild writes into memory that is already allocated and paged in (for a million primitives, zero-filling
+// and faulting in the ~200 MB of fresh arrays costs as much as the build itself)
+class lbvh_builder {
+public:
+    lbvh_builder(ThreadPool& worker_pool, const lbvh_build_options& opt = {}) : pool(worker_pool), options(opt) {
+        options.morton_bits = options.morton_bits > 30 ? 63 : 30;
+        options.max_leaf_size = std::clamp(options.max_leaf_size, 1, kBvhStackSize / 2);     // emit() walks a collapsed subtree with a fixed stack
+    }
+
+    // Same result as bvh_sah_builder::build: out = nodes in depth-first order, prim_order[k] = index (into prim_boxes) of the k-th primitive in leaf order
+    void build(const std::vector<aabb>& prim_boxes, std::vector<bvh_node>& out, std::vector<int>& prim_order, lbvh_build_timings* timings = nullptr) {
+        lbvh_build_timings t;
+        Timer total, step;
+        total.tic();
+        boxes = &prim_boxes;
+        n = int(prim_boxes.size());
+        prim_order.resize(n);
+        if (n == 0) {
+            out.clear();
+            if (timings) *timings = t;
+            return;
+        }
+
+        step.tic();
+        compute_morton_codes();
+        t.morton_ms = step.toc_ms();
+
+        step.tic();
+        radix_sort();
+        t.sort_ms = step.toc_ms();
+
+        // Build nodes: internal i in [0, n-1), leaf k (k-th primitive in Morton order) at n-1+k; the root is node 0 either way
+        // Every entry is written by the passes below, so resize() only has to provide the memory
+        const int num_nodes = 2 * n - 1;
+        left.resize(n - 1);
+        right.resize(n - 1);
+        parent.resize(num_nodes);
+        parent[0] = -1;
+        box.resize(num_nodes);
+        cost.resize(num_nodes);
+        count.resize(num_nodes);
+        out_nodes.resize(num_nodes);
+        collapsed.resize(num_nodes);
+        if (arrivals_size < n - 1) {
+            arrivals_size = n - 1;
+            arrivals.reset(new std::atomic<int>[arrivals_size]);
+        }
+
+        step.tic();
+        build_hierarchy();
+        t.hierarchy_ms = step.toc_ms();
+
+        // Without treelets the first bottom-up pass can already decide the collapses; with them, that waits for the final topology
+        step.tic();
+        init_leaves();
+        bottom_up([&](int node) { refit(node, options.treelet_passes <= 0); });
+        t.bounds_ms = step.toc_ms();
+
+        if (options.treelet_passes > 0) {
+            step.tic();
+            int gamma = std::max(2, options.treelet_min_prims);
+            for (int pass = 0; pass < options.treelet_passes; ++pass, gamma *= 2)
+                bottom_up([&](int node) {
+                    refit(node, false);
+                    if (count[node] >= gamma) optimize_treelet(node);
+                    });
+            bottom_up([&](int node) { refit(node, true); });
+            t.treelet_ms = step.toc_ms();
+        }
+
+        step.tic();
+        write_output(out, prim_order);
+        t.output_ms = step.toc_ms();
+
+        t.total_ms = total.toc_ms();
+        if (timings) *timings = t;
+    }
+
+private:
+    const std::vector<aabb>* boxes = nullptr;
+    ThreadPool& pool;
+    lbvh_build_options options;
+    int n = 0;
+
+    std::vector<uint64_t> keys, keys_tmp;       // Morton codes, sorted together with...
+    std::vector<int> prims, prims_tmp;          // ...the primitive each one belongs to
+
+    std::vector<int> left, right, parent;       // topology (left/right for internal nodes only)
+    std::vector<aabb> box;
+    std::vector<double> cost;                   // SAH cost of the subtree, not normalized by the root area (sum of area * cost factor)
+    std::vector<int> count;                     // primitives in the subtree
+    std::vector<int> out_nodes;                 // bvh_node slots the subtree takes after collapsing
+    std::vector<char> collapsed;                // internal node written as one leaf
+    std::unique_ptr<std::atomic<int>[]> arrivals;
+    int arrivals_size = 0;
+
+    bool is_leaf(int node) const { return node >= n - 1; }
+
+    // f(begin, end, worker) over [0, count) split into one contiguous slice per worker
+    template <typename F>
+    void parallel_for(int total, F&& f) {
+        if (total < kLbvhSerialCutoff || pool.size() == 1) {
+            f(0, total, 0);
+            return;
+        }
+        const int workers = pool.size();
+        pool.run([&](int w) { f(int(int64_t(total) * w / workers), int(int64_t(total) * (w + 1) / workers), w); });
+    }
+
+    // Spread the low bits of v so there are two zero bits between each: 10 bits -> 30, 21 bits -> 63
+    static uint64_t expand_bits_10(uint64_t v) {
+        v &= 0x3FF;
+        v = (v | (v << 16)) & 0x030000FF;
+        v = (v | (v << 8)) & 0x0300F00F;
+        v = (v | (v << 4)) & 0x030C30C3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    static uint64_t expand_bits_21(uint64_t v) {
+        v &= 0x1FFFFF;
+        v = (v | (v << 32)) & 0x001F00000000FFFFull;
+        v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+        v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+        v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+    }
+
+    void compute_morton_codes() {
+        // Centroid bounds: one partial box per worker, merged here
+        std::vector<aabb> partial(pool.size());
+        parallel_for(n, [&](int b, int e, int w) {
+            aabb c;
+            for (int i = b; i < e; ++i) c.grow((*boxes)[i].centroid());
+            partial[w] = c;
+            });
+        aabb cbounds;
+        for (const aabb& c : partial) cbounds.grow(c);
+
+        const int bits_per_axis = options.morton_bits / 3;
+        const double cells = double((1u << bits_per_axis) - 1);
+        double offset[3], scale[3];
+        for (int a = 0; a < 3; ++a) {
+            const double extent = double(cbounds.hi[a]) - double(cbounds.lo[a]);
+            offset[a] = cbounds.lo[a];
+            scale[a] = extent > 0 ? cells / extent : 0.0;      // flat axis: every code gets 0 there
+        }
+
+        keys.resize(n);
+        prims.resize(n);
+        parallel_for(n, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) {
+                const point3 c = (*boxes)[i].centroid();
+                uint64_t q[3];
+                for (int a = 0; a < 3; ++a) q[a] = uint64_t(std::min(cells, std::max(0.0, (double(c[a]) - offset[a]) * scale[a])));
+                keys[i] = bits_per_axis == 10 ? (expand_bits_10(q[0]) << 2) | (expand_bits_10(q[1]) << 1) | expand_bits_10(q[2])
+                                              : (expand_bits_21(q[0]) << 2) | (expand_bits_21(q[1]) << 1) | expand_bits_21(q[2]);
+                prims[i] = i;
+            }
+            });
+    }
+
+    void radix_sort() {
+        keys_tmp.resize(n);
+        prims_tmp.resize(n);
+        const int workers = pool.size();
+        std::vector<size_t> hist(size_t(workers) * 256);
+        const int passes = (options.morton_bits + 7) / 8;
+
+        for (int pass = 0; pass < passes; ++pass) {
+            const int shift = 8 * pass;
+            std::fill(hist.begin(), hist.end(), 0);
+            parallel_for(n, [&](int b, int e, int w) {
+                size_t* h = &hist[size_t(w) * 256];
+                for (int i = b; i < e; ++i) h[(keys[i] >> shift) & 0xFF]++;
+                });
+
+            // Exclusive prefix sum in (digit, worker) order, so worker w's keys with digit d land after workers < w: the scatter stays stable
+            size_t sum = 0;
+            bool trivial = false;
+            for (int d = 0; d < 256; ++d) {
+                size_t digit_total = 0;
+                for (int w = 0; w < workers; ++w) {
+                    const size_t c = hist[size_t(w) * 256 + d];
+                    hist[size_t(w) * 256 + d] = sum;
+                    sum += c;
+                    digit_total += c;
+                }
+                if (digit_total == size_t(n)) trivial = true;
+            }
+            if (trivial) continue;      // all keys share this digit: the order would not change
+
+            parallel_for(n, [&](int b, int e, int w) {
+                size_t* offsets = &hist[size_t(w) * 256];
+                for (int i = b; i < e; ++i) {
+                    const size_t dst = offsets[(keys[i] >> shift) & 0xFF]++;
+                    keys_tmp[dst] = keys[i];
+                    prims_tmp[dst] = prims[i];
+                }
+                });
+            keys.swap(keys_tmp);
+            prims.swap(prims_tmp);
+        }
+    }
+
+    // Length of the common prefix of sorted keys i and j (-1 outside the array); equal keys are extended by the prefix of their indices
+    int delta(int i, int j) const {
+        if (j < 0 || j >= n) return -1;
+        const uint64_t a = keys[i], b = keys[j];
+        if (a == b) return 64 + std::countl_zero(uint32_t(i ^ j));
+        return std::countl_zero(a ^ b);
+    }
+
+    void build_hierarchy() {
+        const int leaf0 = n - 1;
+        parallel_for(n - 1, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) {
+                // Direction of the range: toward the neighbour sharing the longer prefix
+                const int d = delta(i, i + 1) - delta(i, i - 1) >= 0 ? 1 : -1;
+                const int delta_min = delta(i, i - d);
+
+                // Upper bound for the range length, then binary search for the other end j
+                int l_max = 2;
+                while (delta(i, i + l_max * d) > delta_min) l_max *= 2;
+                int l = 0;
+                for (int t = l_max / 2; t >= 1; t /= 2)
+                    if (delta(i, i + (l + t) * d) > delta_min) l += t;
+                const int j = i + l * d;
+
+                // Split: the last key that still shares more than the range's common prefix with i
+                const int delta_node = delta(i, j);
+                int s = 0;
+                for (int t = l;;) {
+                    t = (t + 1) / 2;
+                    if (delta(i, i + (s + t) * d) > delta_node) s += t;
+                    if (t <= 1) break;
+                }
+                const int gamma = i + s * d + std::min(d, 0);
+
+                const int lo = std::min(i, j), hi = std::max(i, j);
+                const int l_child = lo == gamma ? leaf0 + gamma : gamma;
+                const int r_child = hi == gamma + 1 ? leaf0 + gamma + 1 : gamma + 1;
+                left[i] = l_child;
+                right[i] = r_child;
+                parent[l_child] = i;
+                parent[r_child] = i;
+            }
+            });
+    }
+
+    void init_leaves() {
+        parallel_for(n, [&](int b, int e, int) {
+            for (int k = b; k < e; ++k) {
+                const int node = n - 1 + k;
+                box[node] = (*boxes)[prims[k]];
+                count[node] = 1;
+                cost[node] = options.intersection_cost * box[node].surface_area();
+                out_nodes[node] = 1;
+                collapsed[node] = 0;
+            }
+            });
+    }
+
+    // Walk from every leaf toward the root; the second arrival at a node calls visit(node), when both subtrees are final
+    template <typename Visit>
+    void bottom_up(Visit&& visit) {
+        if (n < 2) return;
+        parallel_for(n - 1, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) arrivals[i].store(0, std::memory_order_relaxed);
+            });
+        parallel_for(n, [&](int b, int e, int) {
+            for (int k = b; k < e; ++k) {
+                int node = parent[n - 1 + k];
+                while (node >= 0) {
+                    // acq_rel: the first arrival's subtree writes become visible to the second, which carries on
+                    if (arrivals[node].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+                    visit(node);
+                    node = parent[node];
+                }
+            }
+            });
+    }
+
+    // Box, primitive count and SAH cost of an internal node from its children; with collapse, also the leaf-or-not decision and output size
+    void refit(int node, bool collapse) {
+        const int l = left[node], r = right[node];
+        box[node] = box[l];
+        box[node].grow(box[r]);
+        count[node] = count[l] + count[r];
+        const double area = box[node].surface_area();
+        cost[node] = options.traversal_cost * area + cost[l] + cost[r];
+        collapsed[node] = 0;
+        out_nodes[node] = 1 + out_nodes[l] + out_nodes[r];
+        if (!collapse) return;
+        const double leaf_cost = options.intersection_cost * area * count[node];
+        if (count[node] <= options.max_leaf_size && leaf_cost <= cost[node]) {
+            collapsed[node] = 1;
+            cost[node] = leaf_cost;
+            out_nodes[node] = 1;
+        }
+    }
+
+    // Re-pair the treelet under root (up to 7 treelet leaves, found by repeatedly opening the largest one) into the cheapest topology
+    void optimize_treelet(int root) {
+        int leaves[kLbvhTreeletLeaves];
+        int internals[kLbvhTreeletLeaves - 1];
+        int num_leaves = 2, num_internals = 1;
+        internals[0] = root;
+        leaves[0] = left[root];
+        leaves[1] = right[root];
+        while (num_leaves < kLbvhTreeletLeaves) {
+            int best = -1;
+            double best_area = -1.0;
+            for (int k = 0; k < num_leaves; ++k)
+                if (!is_leaf(leaves[k]) && box[leaves[k]].surface_area() > best_area) {
+                    best_area = box[leaves[k]].surface_area();
+                    best = k;
+                }
+            if (best < 0) break;
+            const int opened = leaves[best];
+            internals[num_internals++] = opened;
+            leaves[best] = left[opened];
+            leaves[num_leaves++] = right[opened];
+        }
+
+        // Optimal cost of every subset of the treelet leaves; subsets of s are numerically smaller than s, so one increasing sweep suffices
+        const int num_subsets = 1 << num_leaves;
+        aabb subset_box[1 << kLbvhTreeletLeaves];
+        double best_cost[1 << kLbvhTreeletLeaves];
+        int split[1 << kLbvhTreeletLeaves] = {};
+        for (int s = 1; s < num_subsets; ++s) {
+            const int low = s & -s;
+            const int rest = s ^ low;
+            const int first = std::countr_zero(unsigned(s));
+            if (rest == 0) {
+                subset_box[s] = box[leaves[first]];
+                best_cost[s] = cost[leaves[first]];
+                continue;
+            }
+            subset_box[s] = subset_box[rest];                       // box of s = box of s without its lowest leaf, grown by that leaf
+            subset_box[s].grow(box[leaves[first]]);
+            // Each partition once: p = the part holding the lowest leaf, q = the rest of p, over every proper subset of 'rest'
+            double best = std::numeric_limits<double>::infinity();
+            for (int q = (rest - 1) & rest;; q = (q - 1) & rest) {
+                const int p = q | low;
+                const double c = best_cost[p] + best_cost[s ^ p];
+                if (c < best) {
+                    best = c;
+                    split[s] = p;
+                }
+                if (q == 0) break;
+            }
+            best_cost[s] = options.traversal_cost * subset_box[s].surface_area() + best;
+        }
+        if (best_cost[num_subsets - 1] >= cost[root] * (1.0 - 1e-9)) return;     // already optimal (within rounding)
+
+        // Rebuild with the same internal nodes; root stays the root, so its parent's pointer is still right
+        int next_internal = 0;
+        auto rebuild = [&](auto& self, int s) -> int {
+            if (std::popcount(unsigned(s)) == 1) return leaves[std::countr_zero(unsigned(s))];
+            const int node = internals[next_internal++];
+            const int l = self(self, split[s]);
+            const int r = self(self, s ^ split[s]);
+            left[node] = l;
+            right[node] = r;
+            parent[l] = node;
+            parent[r] = node;
+            refit(node, false);
+            return node;
+        };
+        rebuild(rebuild, num_subsets - 1);
+    }
+
+    // One work item of the output pass: build node 'node' goes to out[slot], its primitives to prim_order[first, ...)
+    struct output_task {
+        int node, slot, first;
+    };
+
+    // Write the node (and, for an interior node, return its two child tasks in children[0..1])
+    void emit(const output_task& t, std::vector<bvh_node>& out, std::vector<int>& prim_order, output_task children[2]) const {
+        const int node = t.node;
+        if (is_leaf(node) || collapsed[node]) {
+            out[t.slot] = { box[node], t.first, count[node], 0 };
+            // Primitives of the subtree in depth-first order
+            int stack[kBvhStackSize];
+            int sp = 0, k = t.first;
+            stack[sp++] = node;
+            while (sp > 0) {
+                const int cur = stack[--sp];
+                if (is_leaf(cur)) prim_order[k++] = prims[cur - (n - 1)];
+                else {
+                    stack[sp++] = right[cur];
+                    stack[sp++] = left[cur];
+                }
+            }
+            return;
+        }
+        int l = left[node], r = right[node];
+        const point3 cl = box[l].centroid(), cr = box[r].centroid();
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+            if (std::abs(cr[a] - cl[a]) > std::abs(cr[axis] - cl[axis])) axis = a;
+        if (cr[axis] < cl[axis]) std::swap(l, r);       // left child on the negative side of the axis
+        const int right_slot = t.slot + 1 + out_nodes[l];
+        out[t.slot] = { box[node], right_slot, 0, axis };
+        children[0] = { l, t.slot + 1, t.first };
+        children[1] = { r, right_slot, t.first + count[l] };
+    }
+
+    bool expandable(int node) const { return !is_leaf(node) && !collapsed[node]; }
+
+    void write_output(std::vector<bvh_node>& out, std::vector<int>& prim_order) {
+        out.resize(out_nodes[0]);
+
+        // Open the top of the tree breadth-first on this thread until there are enough independent subtrees for the pool
+        std::vector<output_task> tasks = { { 0, 0, 0 } }, next;
+        const size_t target = pool.size() == 1 || n < kLbvhSerialCutoff ? 1 : size_t(8 * pool.size());
+        output_task children[2];
+        while (tasks.size() < target) {
+            bool opened = false;
+            next.clear();
+            for (size_t i = 0; i < tasks.size(); ++i) {
+                const output_task& t = tasks[i];
+                if (expandable(t.node) && next.size() + (tasks.size() - i) < target) {     // opening t adds one task
+                    emit(t, out, prim_order, children);
+                    next.push_back(children[0]);
+                    next.push_back(children[1]);
+                    opened = true;
+                }
+                else next.push_back(t);
+            }
+            tasks.swap(next);
+            if (!opened) break;
+        }
+
+        // Each remaining subtree depth-first; slots and primitive offsets are disjoint, so no synchronization is needed
+        std::atomic<int> next_task{ 0 };
+        auto work = [&](int) {
+            std::vector<output_task> stack;
+            int i;
+            while ((i = next_task.fetch_add(1, std::memory_order_relaxed)) < int(tasks.size())) {
+                stack.push_back(tasks[i]);
+                while (!stack.empty()) {
+                    const output_task t = stack.back();
+                    stack.pop_back();
+                    const bool interior = expandable(t.node);
+                    output_task c[2];
+                    emit(t, out, prim_order, c);
+                    if (interior) {
+                        stack.push_back(c[1]);
+                        stack.push_back(c[0]);
+                    }
+                }
+            }
+        };
+        if (tasks.size() > 1) pool.run(work);
+        else work(0);
+    }
+};
+
+// Build a BVH over arbitrary primitives given only their bounding boxes, on the workers of pool
+inline std::vector<bvh_node> build_bvh_lbvh(const std::vector<aabb>& prim_boxes, std::vector<int>& prim_order, ThreadPool& pool,
+                                            const lbvh_build_options& opt = {}, lbvh_build_timings* timings = nullptr) {
+    std::vector<bvh_node> nodes;
+    lbvh_builder(pool, opt).build(prim_boxes, nodes, prim_order, timings);
+    return nodes;
+}
+
+// bvh over spheres, built with the LBVH instead of the SAH builder
+inline bvh make_bvh_lbvh(const std::vector<sphere>& objects, ThreadPool& pool, const lbvh_build_options& opt = {},
+                         lbvh_build_timings* timings = nullptr) {
+    std::vector<aabb> boxes;
+    boxes.reserve(objects.size());
+    for (const sphere& s : objects) boxes.push_back(s.bounding_box());
+
+    bvh result;
+    std::vector<int> order;
+    result.nodes = build_bvh_lbvh(boxes, order, pool, opt, timings);
+    result.spheres.reserve(objects.size());
+    for (int i : order) result.spheres.push_back(objects[i]);
+    return result;
+}
+
+#endif
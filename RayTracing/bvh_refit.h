@@ -0,0 +1,319 @@
+#ifndef BVH_REFIT_H
+#define BVH_REFIT_H
+
+#include "bvh.h"
+#include "C_thread_pool.h"
+#include "C_timer.h"
+
+#include <algorithm>    // std::max
+#include <atomic>       // arrival counters for the bottom-up pass, task counter for the rebuilds
+#include <cstdint>
+#include <memory>       // std::unique_ptr for the atomic counter array
+#include <type_traits>  // std::is_const_v: reset() measures a const tree with the same pass update() refits with
+#include <vector>
+
+/*
+Refit and selective rebuild: keeps a bvh_node tree (from either builder) valid while its primitives move, without rebuilding it every frame.
+
+Refit. The topology stays as it is and every box is recomputed bottom-up: each leaf takes the union of its primitives' new boxes and walks
+toward the root, and an atomic counter per interior node lets only the second child to arrive continue (the same walk as bvh_lbvh.h's
+bounds pass), so the whole tree is refit in one parallel loop over the leaves. The same walk recomputes every subtree's SAH cost.
+
+Quality. A refit tree is always correct, but when primitives that were grouped together move apart their boxes grow and overlap, and rays
+visit more of them. The measure is each subtree's SAH cost normalized by its root's area (the expected cost of a ray that enters the subtree),
+compared with the same number when the subtree was last built. Rigid motion of a whole subtree leaves it unchanged; only relative motion
+inside a subtree makes it grow.
+
+Selective rebuild. Going down from the root, the first subtree whose cost grew past rebuild_threshold is rebuilt with the binned SAH builder over
+its own primitives, and nothing below it is looked at; smaller subtrees than min_rebuild_prims are never rebuilt. A subtree's primitives are
+contiguous in leaf order, so a rebuild only permutes primitives inside that range, and the boxes of its ancestors are already right after the
+refit. Rebuilt subtrees run in parallel; they usually have a different node count, so the depth-first array is then rewritten around them
+with the other nodes' right-child indices shifted.
+*/
+
+struct bvh_refit_options {
+    double rebuild_threshold = 1.25;    // rebuild a subtree once its normalized SAH cost is this many times its cost when it was built
+    int min_rebuild_prims = 64;         // smaller subtrees are only ever refit
+    bvh_build_options build;            // for the subtree rebuilds, and the cost factors of the SAH metric
+};
+
+// What one update() did
+struct bvh_refit_stats {
+    double refit_ms = 0.0;
+    double rebuild_ms = 0.0;            // SAH rebuilds plus rewriting the node array; 0 when nothing degraded
+    int rebuilt_subtrees = 0;
+    int rebuilt_prims = 0;
+    double root_growth = 1.0;           // the root's normalized SAH cost after the refit, relative to its reference
+    double sah_cost = 0.0;              // SAH cost of the tree after the update, as bvh_stats::sah_cost
+};
+
+constexpr int kBvhRefitSerialCutoff = 4096;     // loops shorter than this run on the calling thread instead of waking the pool
+
+// Keep one refitter per animated tree and call update() every frame; its per-node arrays keep their capacity between frames
+class bvh_refitter {
+public:
+    bvh_refitter(ThreadPool& worker_pool, const bvh_refit_options& opt = {}) : pool(worker_pool), options(opt) {
+        options.min_rebuild_prims = std::max(2, options.min_rebuild_prims);
+    }
+
+    // Take nodes as they are now as the quality reference; call after every full rebuild (update() also does it when the node count changed)
+    void reset(const std::vector<bvh_node>& nodes) {
+        set_topology(nodes);
+        bottom_up(nodes, nullptr);
+        reference.resize(nodes.size());
+        parallel_for(int(nodes.size()), [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) reference[i] = normalized_cost(nodes[i], i);
+            });
+    }
+
+    // Refit nodes to leaf_boxes (leaf_boxes[k] = new box of the k-th primitive in leaf order), then rebuild the subtrees that degraded.
+    // leaf_order receives the new leaf order: new k-th primitive = old leaf_order[k]-th; it is the identity unless a subtree was rebuilt
+    bvh_refit_stats update(std::vector<bvh_node>& nodes, const std::vector<aabb>& leaf_boxes, std::vector<int>& leaf_order) {
+        bvh_refit_stats st;
+        leaf_order.resize(leaf_boxes.size());
+        for (int k = 0; k < int(leaf_order.size()); ++k) leaf_order[k] = k;
+        if (nodes.empty()) return st;
+        if (nodes.size() != parent.size()) reset(nodes);
+
+        Timer t;
+        t.tic();
+        bottom_up(nodes, &leaf_boxes);
+        st.refit_ms = t.toc_ms();
+        st.root_growth = growth(nodes, 0);
+
+        t.tic();
+        select_degraded(nodes);
+        if (!selected.empty()) {
+            rebuild_selected(leaf_boxes, leaf_order);
+            splice(nodes);
+            for (const int s : selected) st.rebuilt_prims += count[s];
+            st.rebuilt_subtrees = int(selected.size());
+
+            // New topology; rebuilt nodes (reference < 0 after the splice) take their current cost as their new reference
+            set_topology(nodes);
+            bottom_up(nodes, nullptr);
+            parallel_for(int(nodes.size()), [&](int b, int e, int) {
+                for (int i = b; i < e; ++i)
+                    if (reference[i] < 0) reference[i] = normalized_cost(nodes[i], i);
+                });
+            st.rebuild_ms = t.toc_ms();
+        }
+        const double root_area = nodes[0].bbox.surface_area();
+        st.sah_cost = root_area > 0 ? cost[0] / root_area : cost[0];
+        return st;
+    }
+
+    // Relative growth of node i's normalized SAH cost since it was built, as of the last update()
+    double growth(const std::vector<bvh_node>& nodes, int i) const {
+        return reference[i] > 0 ? normalized_cost(nodes[i], i) / reference[i] : 1.0;
+    }
+
+private:
+    ThreadPool& pool;
+    bvh_refit_options options;
+
+    std::vector<int> parent;        // -1 for the root
+    std::vector<int> leaves;        // indices of the leaf nodes, the starting points of the bottom-up walk
+    std::vector<double> cost;       // SAH cost of the subtree, not normalized (sum of area * cost factor over its nodes)
+    std::vector<int> count;         // primitives in the subtree
+    std::vector<int> first;         // first primitive of the subtree in leaf order
+    std::vector<int> size;          // nodes in the subtree; it occupies [i, i + size) of the depth-first array
+    std::vector<double> reference;  // normalized cost when the subtree was last built
+    std::unique_ptr<std::atomic<int>[]> arrivals;
+    int arrivals_size = 0;
+
+    // Scratch for the selective rebuild
+    std::vector<int> selected;                          // roots of the subtrees to rebuild, in depth-first (= index) order
+    std::vector<std::vector<bvh_node>> rebuilt;         // their new nodes, leaf ranges already offset into the full leaf order
+    std::vector<bvh_node> spliced;
+    std::vector<double> spliced_reference;
+    std::vector<int> new_index;
+
+    // f(begin, end, worker) over [0, total) split into one contiguous slice per worker
+    template <typename F>
+    void parallel_for(int total, F&& f) {
+        if (total < kBvhRefitSerialCutoff || pool.size() == 1) {
+            f(0, total, 0);
+            return;
+        }
+        const int workers = pool.size();
+        pool.run([&](int w) { f(int(int64_t(total) * w / workers), int(int64_t(total) * (w + 1) / workers), w); });
+    }
+
+    double normalized_cost(const bvh_node& node, int i) const {
+        const double area = node.bbox.surface_area();
+        return area > 0 ? cost[i] / area : cost[i];
+    }
+
+    void set_topology(const std::vector<bvh_node>& nodes) {
+        const int num_nodes = int(nodes.size());
+        parent.resize(num_nodes);
+        cost.resize(num_nodes);
+        count.resize(num_nodes);
+        first.resize(num_nodes);
+        size.resize(num_nodes);
+        if (arrivals_size < num_nodes) {
+            arrivals_size = num_nodes;
+            arrivals.reset(new std::atomic<int>[arrivals_size]);
+        }
+        if (num_nodes == 0) {
+            leaves.clear();
+            return;
+        }
+        parent[0] = -1;
+        parallel_for(num_nodes, [&](int b, int e, int) {     // every interior node writes only its own children's entries
+            for (int i = b; i < e; ++i)
+                if (nodes[i].count == 0) parent[i + 1] = parent[nodes[i].left_first] = i;
+            });
+        leaves.clear();
+        for (int i = 0; i < num_nodes; ++i)
+            if (nodes[i].count > 0) leaves.push_back(i);
+    }
+
+    // Walk from every leaf toward the root, recomputing cost/count/first/size and, when nodes is writable and leaf_boxes is given,
+    // the boxes themselves (reset() runs the same pass on a const tree to measure it)
+    template <typename NodeVector>
+    void bottom_up(NodeVector& nodes, const std::vector<aabb>* leaf_boxes) {
+        constexpr bool writable = !std::is_const_v<NodeVector>;
+        const bvh_build_options& opt = options.build;
+        parallel_for(int(parent.size()), [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) arrivals[i].store(0, std::memory_order_relaxed);
+            });
+        parallel_for(int(leaves.size()), [&](int b, int e, int) {
+            for (int k = b; k < e; ++k) {
+                const int leaf = leaves[k];
+                const bvh_node& ln = nodes[leaf];
+                if constexpr (writable) {
+                    if (leaf_boxes) {
+                        aabb box;
+                        for (int p = ln.left_first; p < ln.left_first + ln.count; ++p) box.grow((*leaf_boxes)[p]);
+                        nodes[leaf].bbox = box;
+                    }
+                }
+                cost[leaf] = opt.intersection_cost * ln.count * ln.bbox.surface_area();
+                count[leaf] = ln.count;
+                first[leaf] = ln.left_first;
+                size[leaf] = 1;
+
+                int node = parent[leaf];
+                while (node >= 0) {
+                    // acq_rel: the first arrival's subtree writes become visible to the second, which carries on
+                    if (arrivals[node].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+                    const int l = node + 1, r = nodes[node].left_first;
+                    if constexpr (writable) {
+                        if (leaf_boxes) nodes[node].bbox = surrounding_box(nodes[l].bbox, nodes[r].bbox);
+                    }
+                    cost[node] = opt.traversal_cost * nodes[node].bbox.surface_area() + cost[l] + cost[r];
+                    count[node] = count[l] + count[r];
+                    first[node] = first[l];
+                    size[node] = 1 + size[l] + size[r];
+                    node = parent[node];
+                }
+            }
+            });
+    }
+
+    // Topmost subtrees whose cost grew past the threshold; the walk pushes right before left, so they come out in index order
+    void select_degraded(const std::vector<bvh_node>& nodes) {
+        selected.clear();
+        std::vector<int> stack = { 0 };
+        while (!stack.empty()) {
+            const int i = stack.back();
+            stack.pop_back();
+            if (nodes[i].count > 0 || count[i] < options.min_rebuild_prims) continue;
+            if (growth(nodes, i) > options.rebuild_threshold) {
+                selected.push_back(i);
+                continue;
+            }
+            stack.push_back(nodes[i].left_first);
+            stack.push_back(i + 1);
+        }
+    }
+
+    // SAH build of every selected subtree over its own primitives, one subtree per task
+    void rebuild_selected(const std::vector<aabb>& leaf_boxes, std::vector<int>& leaf_order) {
+        rebuilt.resize(selected.size());
+        std::atomic<int> next_task{ 0 };
+        auto work = [&](int) {
+            std::vector<aabb> boxes;
+            std::vector<int> order;
+            int s;
+            while ((s = next_task.fetch_add(1, std::memory_order_relaxed)) < int(selected.size())) {
+                const int root = selected[s], begin = first[root], n = count[root];
+                boxes.assign(leaf_boxes.begin() + begin, leaf_boxes.begin() + begin + n);
+                rebuilt[s] = build_bvh_sah(boxes, order, options.build);
+                for (bvh_node& b : rebuilt[s])
+                    if (b.count > 0) b.left_first += begin;     // interior indices are fixed up by splice()
+                for (int k = 0; k < n; ++k) leaf_order[begin + k] = begin + order[k];   // disjoint ranges: no synchronization needed
+            }
+        };
+        if (selected.size() > 1) pool.run(work);
+        else work(0);
+    }
+
+    // Rewrite the depth-first array with every selected subtree replaced by its rebuilt nodes
+    void splice(std::vector<bvh_node>& nodes) {
+        const int old_count = int(nodes.size());
+
+        // New position of every old node that is kept, and of every selected root
+        new_index.resize(old_count);
+        int out = 0;
+        for (int i = 0, s = 0; i < old_count;) {
+            new_index[i] = out;
+            if (s < int(selected.size()) && selected[s] == i) {
+                out += int(rebuilt[s].size());
+                i += size[i];
+                ++s;
+            }
+            else {
+                ++out;
+                ++i;
+            }
+        }
+
+        spliced.resize(out);
+        spliced_reference.resize(out);
+        for (int i = 0, s = 0; i < old_count;) {
+            const int at = new_index[i];
+            if (s < int(selected.size()) && selected[s] == i) {
+                const std::vector<bvh_node>& sub = rebuilt[s];
+                for (int k = 0; k < int(sub.size()); ++k) {
+                    spliced[at + k] = sub[k];
+                    if (sub[k].count == 0) spliced[at + k].left_first += at;
+                    spliced_reference[at + k] = -1.0;
+                }
+                i += size[i];
+                ++s;
+            }
+            else {
+                spliced[at] = nodes[i];
+                if (nodes[i].count == 0) spliced[at].left_first = new_index[nodes[i].left_first];
+                spliced_reference[at] = reference[i];
+                ++i;
+            }
+        }
+        nodes.swap(spliced);
+        reference.swap(spliced_reference);
+    }
+};
+
+// Refit a sphere bvh after its spheres (stored in leaf order) moved. If a subtree was rebuilt the spheres are reordered, and permutation,
+// when given, receives the new order (new k-th sphere = old permutation[k]-th) so the caller can reorder whatever it keeps per sphere
+inline bvh_refit_stats refit_bvh(bvh& tree, bvh_refitter& refitter, std::vector<int>* permutation = nullptr) {
+    std::vector<aabb> boxes;
+    boxes.reserve(tree.spheres.size());
+    for (const sphere& s : tree.spheres) boxes.push_back(s.bounding_box());
+
+    std::vector<int> order;
+    const bvh_refit_stats st = refitter.update(tree.nodes, boxes, order);
+    if (st.rebuilt_subtrees > 0) {
+        std::vector<sphere> reordered;
+        reordered.reserve(tree.spheres.size());
+        for (const int k : order) reordered.push_back(tree.spheres[k]);
+        tree.spheres.swap(reordered);
+    }
+    if (permutation) permutation->swap(order);
+    return st;
+}
+
+#endif
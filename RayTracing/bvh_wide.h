@@ -0,0 +1,341 @@
+#ifndef BVH_WIDE_H
+#define BVH_WIDE_H
+
+#include "bvh.h"
+#include "C_cpu_features.h"
+#include "C_cpu_dispatch.h"     // active_simd_level(): the 8-wide AVX2 box test is only used when the dispatch level allows it
+
+#include <algorithm>    // std::max
+#include <bit>          // std::countr_zero
+#include <cmath>        // std::nextafter, std::abs, std::signbit
+#include <limits>
+#include <vector>
+#ifdef RT_X86
+#include <immintrin.h>  // SSE / AVX box tests
+#endif
+
+/*
+Wide BVH: the binary hierarchy of bvh.h (from either builder) collapsed into nodes with up to W = 4 or 8 children.
+
+Why: binary traversal tests one box per step and most of its time goes to the dependent chain load node -> test box -> pick child -> load node.
+A wide node holds the boxes of all its children, so one SIMD slab test (SSE for 4 boxes, AVX for 8) decides which of them the ray enters,
+the tree is about log2(W) times shallower, and the stack holds far fewer entries.
+
+Collapse: every wide node starts from one binary node and repeatedly opens (replaces by its two children) the child with the largest surface area,
+since that is the one a random ray is most likely to enter, until it has W children or only binary leaves remain. Binary leaves stay leaves and
+keep their primitive ranges, so a wide BVH uses the same primitive order as the binary tree it came from.
+
+Layout: structure of arrays. A node stores min x / min y / min z / max x / max y / max z for its W children as 6 rows of W floats, so the
+test loads each row with one vector load. Boxes are stored in float even in a double build, which halves the node size; they are rounded
+outward, the float ray setup carries the origin's rounding error as slack, and the far distance is scaled up as in pbrt's robust slab test,
+so the float test never rejects a box the exact test would accept. Unused slots hold empty boxes (min = +inf, max = -inf), which no ray enters.
+
+Traversal: the children a ray enters are pushed ordered by entry distance (nearest on top), each with that distance, and entries whose box
+is entered beyond the closest hit found so far are skipped when popped.
+*/
+
+template <int W>
+struct alignas(32) bvh_wide_node {
+    static_assert(W == 4 || W == 8, "wide BVH nodes are 4 or 8 wide");
+    float bounds[6][W];     // rows 0-2: min x, y, z; rows 3-5: max x, y, z; column = child slot
+    int child[W];           // interior child: index of its wide node; leaf child: first primitive
+    int count[W];           // leaf child: number of primitives; interior child: 0; empty slot: -1
+};
+
+// Children are bounded by the same depth as the binary tree, so a stack of (W - 1) entries per binary stack entry always suffices
+template <int W>
+constexpr int kBvhWideStackSize = (W - 1) * kBvhStackSize;
+
+// Largest float <= v / smallest float >= v
+inline float float_round_down(double v) {
+    float f = float(v);
+    return double(f) > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+inline float float_round_up(double v) {
+    float f = float(v);
+    return double(f) < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+template <int W>
+inline std::vector<bvh_wide_node<W>> collapse_bvh_wide(const std::vector<bvh_node>& binary) {
+    std::vector<bvh_wide_node<W>> wide;
+    if (binary.empty()) return wide;
+
+    // (binary node to turn into a wide node, wide node whose child slot points to it); the root has no parent slot
+    struct pending {
+        int binary_index, parent, slot;
+    };
+    std::vector<pending> todo = { { 0, -1, -1 } };
+    while (!todo.empty()) {
+        const pending p = todo.back();
+        todo.pop_back();
+        const int index = int(wide.size());
+        if (p.parent >= 0) wide[p.parent].child[p.slot] = index;
+        wide.emplace_back();
+
+        // Open the largest interior child until there are W children
+        int kids[W];
+        int n = 1;
+        kids[0] = p.binary_index;
+        while (n < W) {
+            int best = -1;
+            double best_area = -1.0;
+            for (int k = 0; k < n; ++k) {
+                const bvh_node& b = binary[kids[k]];
+                if (b.count == 0 && b.bbox.surface_area() > best_area) {
+                    best_area = b.bbox.surface_area();
+                    best = k;
+                }
+            }
+            if (best < 0) break;        // only leaves left
+            const int opened = kids[best];
+            kids[best] = opened + 1;                    // left child follows its parent in the depth-first array
+            kids[n++] = binary[opened].left_first;      // right child
+        }
+
+        bvh_wide_node<W>& node = wide[index];
+        for (int k = 0; k < W; ++k) {
+            if (k >= n) {
+                for (int a = 0; a < 3; ++a) {
+                    node.bounds[a][k] = std::numeric_limits<float>::infinity();
+                    node.bounds[3 + a][k] = -std::numeric_limits<float>::infinity();
+                }
+                node.child[k] = 0;
+                node.count[k] = -1;
+                continue;
+            }
+            const bvh_node& b = binary[kids[k]];
+            for (int a = 0; a < 3; ++a) {
+                node.bounds[a][k] = float_round_down(b.bbox.lo[a]);
+                node.bounds[3 + a][k] = float_round_up(b.bbox.hi[a]);
+            }
+            if (b.count > 0) {
+                node.child[k] = b.left_first;
+                node.count[k] = b.count;
+            }
+            else {
+                node.child[k] = -1;                     // patched when the child's wide node is created
+                node.count[k] = 0;
+            }
+        }
+        // Pushed in reverse so the first child's subtree is laid out right after this node
+        for (int k = n - 1; k >= 0; --k)
+            if (binary[kids[k]].count == 0) todo.push_back({ kids[k], index, k });
+    }
+    return wide;
+}
+
+// Per-ray constants of the float slab test
+struct bvh_wide_ray {
+    float org[3], inv[3];
+    float slack[3];         // |origin rounding error| / |direction|: how far a plane distance can be off because the origin was rounded to float
+    int near_row[3], far_row[3];    // the min plane is entered first for a positive direction, the max plane for a negative one (including -0.0)
+
+    explicit bvh_wide_ray(const ray& r) {
+        for (int a = 0; a < 3; ++a) {
+            const double o = r.origin()[a], d = r.direction()[a];
+            org[a] = float(o);
+            inv[a] = float(1.0 / d);
+            const double err = std::abs(o - double(org[a]));
+            // A zero component keeps the ray on one coordinate, and rounding to nearest cannot move it across a float box plane, so it needs no slack
+            // (err / |d| would be inf there and no box would ever be culled on that axis)
+            slack[a] = err == 0.0 || d == 0.0 ? 0.0f : float_round_up(err * std::abs(1.0 / d));
+            near_row[a] = std::signbit(d) ? 3 + a : a;     // signbit, not d < 0: a -0.0 component has inv = -inf, so it must enter at the max plane
+            far_row[a] = std::signbit(d) ? a : 3 + a;
+        }
+    }
+};
+
+// 1 + 2 * gamma(3) for float (pbrt): the far distance grows by this factor so the rounding of the three slab computations cannot make a hit box look missed
+constexpr float kBvhWideFarScale = 1.0f + 2.0f * (3.0f * 0x1p-24f) / (1.0f - 3.0f * 0x1p-24f);
+
+// Portable test of all W children: returns a bit mask of the boxes the ray enters within [tmin, tmax] and writes their entry distances
+template <int W>
+inline unsigned bvh_wide_slab_scalar(const bvh_wide_node<W>& node, const bvh_wide_ray& r, float tmin, float tmax, float* t_near) {
+    unsigned mask = 0;
+    for (int k = 0; k < W; ++k) {
+        float t0 = tmin, t1 = tmax;
+        for (int a = 0; a < 3; ++a) {
+            const float tn = (node.bounds[r.near_row[a]][k] - r.org[a]) * r.inv[a] - r.slack[a];
+            const float tf = ((node.bounds[r.far_row[a]][k] - r.org[a]) * r.inv[a] + r.slack[a]) * kBvhWideFarScale;
+            t0 = tn > t0 ? tn : t0;     // written so a NaN distance (0 * inf on a flat box edge) leaves t0 / t1 unchanged
+            t1 = tf < t1 ? tf : t1;
+        }
+        t_near[k] = t0;
+        if (t0 <= t1) mask |= 1u << k;
+    }
+    return mask;
+}
+
+#ifdef RT_X86
+// SSE, 4 children from column col; max/min take the new distance as the first operand, so a NaN there yields the running bound
+template <int W>
+inline unsigned bvh_wide_slab_sse4(const bvh_wide_node<W>& node, const bvh_wide_ray& r, int col, float tmin, float tmax, float* t_near) {
+    __m128 t0 = _mm_set1_ps(tmin), t1 = _mm_set1_ps(tmax);
+    const __m128 far_scale = _mm_set1_ps(kBvhWideFarScale);
+    for (int a = 0; a < 3; ++a) {
+        const __m128 o = _mm_set1_ps(r.org[a]), inv = _mm_set1_ps(r.inv[a]), slack = _mm_set1_ps(r.slack[a]);
+        const __m128 tn = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.bounds[r.near_row[a]][col]), o), inv), slack);
+        const __m128 tf = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.bounds[r.far_row[a]][col]), o), inv), slack), far_scale);
+        t0 = _mm_max_ps(tn, t0);
+        t1 = _mm_min_ps(tf, t1);
+    }
+    _mm_storeu_ps(t_near + col, t0);
+    return unsigned(_mm_movemask_ps(_mm_cmple_ps(t0, t1))) << col;
+}
+
+template <int W>
+inline unsigned bvh_wide_slab_sse(const bvh_wide_node<W>& node, const bvh_wide_ray& r, float tmin, float tmax, float* t_near) {
+    unsigned mask = bvh_wide_slab_sse4(node, r, 0, tmin, tmax, t_near);
+    if constexpr (W == 8) mask |= bvh_wide_slab_sse4(node, r, 4, tmin, tmax, t_near);
+    return mask;
+}
+
+// AVX, all 8 children at once
+RT_TARGET_AVX2 inline unsigned bvh_wide_slab_avx(const bvh_wide_node<8>& node, const bvh_wide_ray& r, float tmin, float tmax, float* t_near) {
+    __m256 t0 = _mm256_set1_ps(tmin), t1 = _mm256_set1_ps(tmax);
+    const __m256 far_scale = _mm256_set1_ps(kBvhWideFarScale);
+    for (int a = 0; a < 3; ++a) {
+        const __m256 o = _mm256_set1_ps(r.org[a]), inv = _mm256_set1_ps(r.inv[a]), slack = _mm256_set1_ps(r.slack[a]);
+        const __m256 tn = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[r.near_row[a]]), o), inv), slack);
+        const __m256 tf = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[r.far_row[a]]), o), inv), slack), far_scale);
+        t0 = _mm256_max_ps(tn, t0);
+        t1 = _mm256_min_ps(tf, t1);
+    }
+    _mm256_storeu_ps(t_near, t0);
+    return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+}
+#endif
+
+// The traversal loop, shared by the SSE/scalar and AVX instantiations below (a macro rather than a template, because the AVX copy
+// has to be compiled inside a target("avx2") function for the box test to be inlined into it)
+#define RT_BVH_WIDE_TRAVERSE(SLAB_TEST)                                                                                     \
+    if (nodes.empty()) return false;                                                                                        \
+    const bvh_wide_ray wr(r);                                                                                               \
+    const float tmin = float_round_down(double(ray_tmin));                                                                  \
+    struct entry { int ref, count; float t_near; };                                                                         \
+    entry stack[kBvhWideStackSize<W>];                                                                                      \
+    int sp = 0;                                                                                                             \
+    entry cur = { 0, 0, tmin };                                                                                             \
+    bool hit_anything = false;                                                                                              \
+    for (;;) {                                                                                                              \
+        if (cur.count > 0) {                                                                                                \
+            for (int k = cur.ref; k < cur.ref + cur.count; k++)                                                             \
+                if (intersect(k, ray_tmax)) hit_anything = true;                                                            \
+        }                                                                                                                   \
+        else {                                                                                                              \
+            const bvh_wide_node<W>& node = nodes[cur.ref];                                                                  \
+            alignas(32) float t_near[W];                                                                                    \
+            unsigned mask = SLAB_TEST(node, wr, tmin, float_round_up(double(ray_tmax)), t_near);                            \
+            /* Insertion sort of the entered children by distance, then push the farthest first */                         \
+            int order[W];                                                                                                   \
+            int m = 0;                                                                                                      \
+            while (mask) {                                                                                                  \
+                const int c = std::countr_zero(mask);                                                                       \
+                mask &= mask - 1;                                                                                           \
+                int j = m++;                                                                                                \
+                while (j > 0 && t_near[order[j - 1]] > t_near[c]) { order[j] = order[j - 1]; --j; }                         \
+                order[j] = c;                                                                                               \
+            }                                                                                                               \
+            for (int k = m - 1; k >= 0; --k) stack[sp++] = { node.child[order[k]], node.count[order[k]], t_near[order[k]] }; \
+        }                                                                                                                   \
+        /* Next entry, skipping boxes that start beyond the closest hit so far */                                           \
+        for (;;) {                                                                                                          \
+            if (sp == 0) return hit_anything;                                                                               \
+            cur = stack[--sp];                                                                                              \
+            if (cur.t_near <= ray_tmax) break;                                                                              \
+        }                                                                                                                   \
+    }
+
+template <int W, typename Intersect>
+inline bool traverse_bvh_wide_portable(const std::vector<bvh_wide_node<W>>& nodes, const ray& r, real ray_tmin, real& ray_tmax, Intersect& intersect) {
+#ifdef RT_X86
+    RT_BVH_WIDE_TRAVERSE(bvh_wide_slab_sse<W>)
+#else
+    RT_BVH_WIDE_TRAVERSE(bvh_wide_slab_scalar<W>)
+#endif
+}
+
+#ifdef RT_X86
+template <int W, typename Intersect>
+RT_TARGET_AVX2 inline bool traverse_bvh_wide_avx(const std::vector<bvh_wide_node<W>>& nodes, const ray& r, real ray_tmin, real& ray_tmax, Intersect& intersect) {
+    RT_BVH_WIDE_TRAVERSE(bvh_wide_slab_avx)
+}
+#endif
+#undef RT_BVH_WIDE_TRAVERSE
+
+// Closest-hit traversal with the same contract as traverse_bvh; 8-wide nodes use one AVX test per node when the dispatch level is AVX2 or better,
+// otherwise two SSE tests
+template <int W, typename Intersect>
+inline bool traverse_bvh_wide(const std::vector<bvh_wide_node<W>>& nodes, const ray& r, real ray_tmin, real& ray_tmax, Intersect&& intersect) {
+#ifdef RT_X86
+    if constexpr (W == 8)
+        if (active_simd_level() >= SimdLevel::AVX2) return traverse_bvh_wide_avx<W>(nodes, r, ray_tmin, ray_tmax, intersect);
+#endif
+    return traverse_bvh_wide_portable<W>(nodes, r, ray_tmin, ray_tmax, intersect);
+}
+
+// Node count, memory and average fill of a wide BVH
+struct bvh_wide_stats {
+    int node_count = 0;
+    int leaf_slots = 0;
+    int max_depth = 0;
+    double mean_children = 0.0;     // used slots per node; W means every node is full
+    size_t bytes = 0;
+};
+
+template <int W>
+inline bvh_wide_stats compute_bvh_wide_stats(const std::vector<bvh_wide_node<W>>& nodes) {
+    bvh_wide_stats st;
+    st.node_count = int(nodes.size());
+    st.bytes = nodes.size() * sizeof(bvh_wide_node<W>);
+    if (nodes.empty()) return st;
+    long long used = 0;
+    std::vector<std::pair<int, int>> stack = { { 0, 1 } };
+    while (!stack.empty()) {
+        auto [index, depth] = stack.back();
+        stack.pop_back();
+        st.max_depth = std::max(st.max_depth, depth);
+        for (int k = 0; k < W; ++k) {
+            const int c = nodes[index].count[k];
+            if (c < 0) continue;
+            ++used;
+            if (c > 0) ++st.leaf_slots;
+            else stack.push_back({ nodes[index].child[k], depth + 1 });
+        }
+    }
+    st.mean_children = double(used) / double(nodes.size());
+    return st;
+}
+
+// Wide BVH over spheres, collapsed from a binary bvh (SAH or LBVH) and sharing its leaf order
+template <int W>
+class bvh_wide : public hittable {
+public:
+    bvh_wide() {}
+
+    explicit bvh_wide(const bvh& binary) : nodes(collapse_bvh_wide<W>(binary.nodes)), spheres(binary.spheres),
+        bounds(binary.bounding_box()) {}
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        return traverse_bvh_wide(nodes, r, ray_tmin, ray_tmax, [&](int k, real& t_max) {
+            if (!spheres[k].hit(r, ray_tmin, t_max, rec)) return false;
+            t_max = rec.t;
+            return true;
+            });
+    }
+
+    aabb bounding_box() const override { return bounds; }
+
+    bvh_wide_stats stats() const { return compute_bvh_wide_stats(nodes); }
+
+    std::vector<bvh_wide_node<W>> nodes;
+    std::vector<sphere> spheres;
+    aabb bounds;
+};
+
+using bvh4 = bvh_wide<4>;
+using bvh8 = bvh_wide<8>;
+
+#endif
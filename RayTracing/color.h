@@ -10,10 +10,13 @@ Defines color as an alias for vec3 and provides a write_color function that conv
 into 8-bit values (0–255) and writes them to an output stream in text form, suitable for constructing PPM images
 */
 
-using color = vec3;         // color is an alias (nickname) for vec3 class; vec3 is a 3D vector storing 3 doubles, .x(), .y(), .z()
+using color = vec3;         // color is an alias (nickname) for vec3 class; vec3 is a 3D vector storing 3 reals (double, or float with RT_USE_FLOAT), .x(), .y(), .z()
     // color c(1.0, 0.0, 0.0) is the same as vec3 c(1.0, 0.0, 0.0)
+template <typename T>
+using color_t = vec3_t<T>;  // color at a fixed precision
 
-void write_color(std::ostream& out, const color& pixel_color) {     // void is the function return type - returns nothing
+template <typename T>
+void write_color(std::ostream& out, const color_t<T>& pixel_color) {     // void is the function return type - returns nothing; works for float and double colors
     // The .x(), .y(), .z() of the vec3 class are interpreted as r, g and b
     auto r = pixel_color.x();
     auto g = pixel_color.y();
@@ -0,0 +1,37 @@
+#ifndef HITTABLE_H
+#define HITTABLE_H
+
+#include "ray.h"
+#include "aabb.h"
+
+/*
+hit_record stores where and how a ray hit a surface; hittable is the interface every object a ray can hit implements.
+The normal is always stored facing against the incoming ray, and front_face remembers whether the ray came from outside the object.
+*/
+
+class hit_record {
+public:
+    point3 p;           // hit point
+    vec3 normal;        // unit surface normal, facing against the ray
+    real t;             // ray parameter of the hit: p = r.at(t)
+    bool front_face;    // true if the ray hit the outside of the surface
+
+    // outward_normal is assumed to have unit length
+    void set_face_normal(const ray& r, const vec3& outward_normal) {
+        front_face = dot(r.direction(), outward_normal) < 0;
+        normal = front_face ? outward_normal : -outward_normal;
+    }
+};
+
+class hittable {
+public:
+    virtual ~hittable() = default;
+
+    // Report the closest hit with t in (ray_tmin, ray_tmax), if any
+    virtual bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const = 0;
+
+    // Box enclosing the whole object, used to build bounding volume hierarchies
+    virtual aabb bounding_box() const = 0;
+};
+
+#endif
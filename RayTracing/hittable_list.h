@@ -0,0 +1,50 @@
+#ifndef HITTABLE_LIST_H
+#define HITTABLE_LIST_H
+
+#include "hittable.h"
+
+#include <memory>       // std::shared_ptr
+#include <vector>
+
+/*
+hittable_list tests a ray against every object it holds and keeps the closest hit.
+Cost is linear in the number of objects, so it is only meant for small scenes and as a reference for checking bvh.h.
+*/
+
+class hittable_list : public hittable {
+public:
+    std::vector<std::shared_ptr<hittable>> objects;
+
+    hittable_list() {}
+    hittable_list(std::shared_ptr<hittable> object) { add(object); }
+
+    void clear() { objects.clear(); box = aabb(); }
+
+    void add(std::shared_ptr<hittable> object) {
+        objects.push_back(object);
+        box.grow(object->bounding_box());
+    }
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        hit_record temp_rec;
+        bool hit_anything = false;
+        auto closest_so_far = ray_tmax;
+
+        for (const auto& object : objects) {
+            if (object->hit(r, ray_tmin, closest_so_far, temp_rec)) {
+                hit_anything = true;
+                closest_so_far = temp_rec.t;        // only accept later hits that are closer
+                rec = temp_rec;
+            }
+        }
+
+        return hit_anything;
+    }
+
+    aabb bounding_box() const override { return box; }
+
+private:
+    aabb box;
+};
+
+#endif
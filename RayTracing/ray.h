@@ -3,33 +3,37 @@
 
 #include "vec3.h"
 
-class ray {
+// Templated over the scalar type like vec3_t; 'ray' is the one at the selected precision (real)
+template <typename T>
+class ray_t {
 public:             // visible to anyone who uses this class
-    ray() {}        // default constructor
+    ray_t() {}      // default constructor
 
     // Declare a constructor that sets origin and direction and uses the member initializer list ": orig(origin), dir(direction)"
-    ray(const point3& origin, const vec3& direction) : orig(origin), dir(direction) {}      // point3 is alias of vec3
+    ray_t(const point3_t<T>& origin, const vec3_t<T>& direction) : orig(origin), dir(direction) {}      // point3 is alias of vec3
 
     // Define getter functions - "const ... const" returns a const reference (cant modify the internals via this return)
-    const point3& origin() const { return orig; }   // starting point of ray
-    const vec3& direction() const { return dir; }   // direction vector of ray
+    const point3_t<T>& origin() const { return orig; }  // starting point of ray
+    const vec3_t<T>& direction() const { return dir; }  // direction vector of ray
 
         // 'const point3&' means the function returns a reference to the internal member, but the reference is read-only and immutable
         // ray::origin() and ray::direction() both return an immutable reference to their members
 
     // Parametric ray equation: P(t) = origin + t * direction
-    point3 at(double t) const {
+    point3_t<T> at(T t) const {
         return orig + t * dir;
     
         // for positive t, you only get vector that goes in front of the origin -> half-line of a ray
     }
 
 private:            // internal data that only the class itself can access
-    point3 orig;    // stores 3D starting point of ray
-    vec3 dir;       // stores direction vector
+    point3_t<T> orig;   // stores 3D starting point of ray
+    vec3_t<T> dir;      // stores direction vector
 
 };
 
+using ray = ray_t<real>;
+
 // caller is code that calls the function
 // If the caller writes "const point3& o = r.origin();" o is now an alias for r.orig; it is not a copy (efficient) and is immutable
 // If the caller writes "point3 o = r.origin();" a new point3 object with same values as r.orig is created; this copy belongs to the caller and can be modified freely
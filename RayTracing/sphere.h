@@ -0,0 +1,57 @@
+#ifndef SPHERE_H
+#define SPHERE_H
+
+#include "hittable.h"
+#include "vec3.h"
+
+#include <cmath>
+
+/*
+sphere is a hittable defined by center and radius.
+Ray-sphere intersection solves |origin + t*direction - center|^2 = radius^2, a quadratic in t.
+With h = b/2 the quadratic formula simplifies to t = (h -+ sqrt(h*h - a*c)) / a.
+*/
+
+class sphere final : public hittable {       // final: the bvh stores spheres by value and calls hit() without a virtual dispatch
+public:
+    sphere() : center(0, 0, 0), radius(0) {}
+    sphere(const point3& c, real r) : center(c), radius(std::fmax(real(0), r)) {}
+
+    bool hit(const ray& r, real ray_tmin, real ray_tmax, hit_record& rec) const override {
+        vec3 oc = center - r.origin();
+        auto a = r.direction().length_squared();
+        auto h = dot(r.direction(), oc);
+        auto c = oc.length_squared() - radius * radius;
+
+        auto discriminant = h * h - a * c;
+        if (discriminant < 0)
+            return false;
+
+        auto sqrtd = std::sqrt(discriminant);
+
+        // Find the nearest root that lies in the acceptable range
+        auto root = (h - sqrtd) / a;
+        if (root <= ray_tmin || ray_tmax <= root) {
+            root = (h + sqrtd) / a;
+            if (root <= ray_tmin || ray_tmax <= root)
+                return false;
+        }
+
+        rec.t = root;
+        rec.p = r.at(rec.t);
+        vec3 outward_normal = (rec.p - center) / radius;
+        rec.set_face_normal(r, outward_normal);
+
+        return true;
+    }
+
+    aabb bounding_box() const override {
+        vec3 rvec(radius, radius, radius);
+        return aabb(center - rvec, center + rvec);
+    }
+
+    point3 center;
+    real radius;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "vec3.h"
+#include "ray.h"
+#include "aabb.h"
+
+#include <cmath>        // std::sin, std::cos, std::abs
+#include <limits>
+
+/*
+affine3 is an affine transform p -> A p + t, stored as the 3 x 4 matrix [A | t] (row i = A's row i, then t[i]).
+Points get the translation, vectors (ray directions) do not, and normals go through the inverse transpose of A so they stay perpendicular
+to the transformed surface. Transforming a ray by the inverse of an object's transform, without renormalizing the direction, keeps the
+ray parameter t the same in both spaces, so a hit found in object space is at the same t in world space.
+*/
+
+class affine3 {
+public:
+    real m[3][4];
+
+    affine3() : m{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } {}
+
+    static affine3 translation(const vec3& t) {
+        affine3 x;
+        for (int i = 0; i < 3; i++) x.m[i][3] = t[i];
+        return x;
+    }
+
+    static affine3 scaling(const vec3& s) {
+        affine3 x;
+        for (int i = 0; i < 3; i++) x.m[i][i] = s[i];
+        return x;
+    }
+
+    // Rotation by angle radians about the y axis, right-handed: +x turns toward -z
+    static affine3 rotation_y(double angle) {
+        affine3 x;
+        const real c = real(std::cos(angle)), s = real(std::sin(angle));
+        x.m[0][0] = c;
+        x.m[0][2] = s;
+        x.m[2][0] = -s;
+        x.m[2][2] = c;
+        return x;
+    }
+
+    point3 point(const point3& p) const {
+        return point3(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+                      m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+                      m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]);
+    }
+
+    vec3 vector(const vec3& v) const {
+        return vec3(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+                    m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+                    m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+    }
+
+    // A^T v: called on the inverse transform, this maps an object-space normal to world space
+    vec3 transpose_vector(const vec3& v) const {
+        return vec3(m[0][0] * v[0] + m[1][0] * v[1] + m[2][0] * v[2],
+                    m[0][1] * v[0] + m[1][1] * v[1] + m[2][1] * v[2],
+                    m[0][2] * v[0] + m[1][2] * v[1] + m[2][2] * v[2]);
+    }
+
+    ray apply(const ray& r) const { return ray(point(r.origin()), vector(r.direction())); }
+
+    // Box around the transformed corners of b, from the extremes of each matrix entry times the box (Arvo, Graphics Gems 1990),
+    // grown by a few ulps so rounding in the transform cannot leave part of the object outside it
+    aabb apply(const aabb& b) const {
+        if (b.empty()) return b;
+        point3 lo, hi;
+        for (int i = 0; i < 3; i++) {
+            lo[i] = hi[i] = m[i][3];
+            for (int j = 0; j < 3; j++) {
+                const real e = m[i][j] * b.lo[j], f = m[i][j] * b.hi[j];
+                lo[i] += e < f ? e : f;
+                hi[i] += e < f ? f : e;
+            }
+            const real pad = 4 * std::numeric_limits<real>::epsilon() * (std::abs(lo[i]) + std::abs(hi[i]));
+            lo[i] -= pad;
+            hi[i] += pad;
+        }
+        return aabb(lo, hi);
+    }
+
+    // Inverse transform, [A^-1 | -A^-1 t], computed in double from the cofactors of A; A must not be singular
+    affine3 inverse() const {
+        double a[3][3];
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++) a[i][j] = m[i][j];
+        const double c00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+        const double c01 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+        const double c02 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+        const double inv_det = 1.0 / (a[0][0] * c00 + a[0][1] * c01 + a[0][2] * c02);
+        const double inv[3][3] = {
+            { c00 * inv_det, (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * inv_det, (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * inv_det },
+            { c01 * inv_det, (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * inv_det, (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * inv_det },
+            { c02 * inv_det, (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * inv_det, (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * inv_det },
+        };
+        affine3 x;
+        for (int i = 0; i < 3; i++) {
+            double t = 0.0;
+            for (int j = 0; j < 3; j++) {
+                x.m[i][j] = real(inv[i][j]);
+                t -= inv[i][j] * m[j][3];
+            }
+            x.m[i][3] = real(t);
+        }
+        return x;
+    }
+};
+
+// a * b applies b first, then a
+inline affine3 operator*(const affine3& a, const affine3& b) {
+    affine3 x;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            real v = j == 3 ? a.m[i][3] : real(0);
+            for (int k = 0; k < 3; k++) v += a.m[i][k] * b.m[k][j];
+            x.m[i][j] = v;
+        }
+    }
+    return x;
+}
+
+#endif
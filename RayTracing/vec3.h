@@ -9,99 +9,127 @@ vec3 class represents a 3D vector, with constructors, element access, arithmetic
 It provides utility functions such as dot product, cross product, unit vector normalization, and overloaded operators for vector arithmetic and printing.
 It also creates an alias 'point3' for vec3 to distinguish between vectors used as directions vs. points in 3D space
 
+vec3_t<T> is written once for any scalar type T; 'real' picks the precision the rest of the ray tracer uses, and vec3 is vec3_t<real>
 */
 
-// double is used here for greater precision and range, but twice the size of float; some ray tracers use float
+// double gives greater precision and range, but is twice the size of float: float halves memory traffic and doubles the lanes per SIMD register
+// The default stays double so results can be checked for accuracy; define RT_USE_FLOAT (CMake option RT_USE_FLOAT) to build everything with float
+#ifdef RT_USE_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
 
-class vec3 {
+template <typename T>
+class vec3_t {
 public:
-	double e[3];
+    using value_type = T;
 
-	vec3() : e{ 0,0,0 } {}
-	vec3(double e0, double e1, double e2) : e{ e0, e1, e2 } {}
+	T e[3];
 
-	double x() const { return e[0]; }
-	double y() const { return e[1]; }
-	double z() const { return e[2]; }
+	vec3_t() : e{ 0,0,0 } {}
+	vec3_t(T e0, T e1, T e2) : e{ e0, e1, e2 } {}
 
-	vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
-    double operator[](int i) const { return e[i]; }
-    double& operator[](int i) { return e[i]; }
+	T x() const { return e[0]; }
+	T y() const { return e[1]; }
+	T z() const { return e[2]; }
 
-    vec3& operator+=(const vec3& v) {
+	vec3_t operator-() const { return vec3_t(-e[0], -e[1], -e[2]); }
+    T operator[](int i) const { return e[i]; }
+    T& operator[](int i) { return e[i]; }
+
+    vec3_t& operator+=(const vec3_t& v) {
         e[0] += v.e[0];
         e[1] += v.e[1];
         e[2] += v.e[2];
         return *this;
     }
 
-    vec3& operator*=(double t) {
+    vec3_t& operator*=(T t) {
         e[0] *= t;
         e[1] *= t;
         e[2] *= t;
         return *this;
     }
 
-    vec3& operator/=(double t) {
-        return *this *= 1 / t;
+    vec3_t& operator/=(T t) {
+        return *this *= T(1) / t;
     }
 
-    double length() const {
+    T length() const {
         return std::sqrt(length_squared());
     }
 
-    double length_squared() const {
+    T length_squared() const {
         return e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
     }
 };
 
+// The ray tracer's vector type at the selected precision, plus fixed-precision names for code that needs one explicitly
+using vec3 = vec3_t<real>;
+using vec3f = vec3_t<float>;
+using vec3d = vec3_t<double>;
+
 // point3 is just an alias for vec3, but useful for geometric clarity in the code - point in space vs direction vector
+template <typename T>
+using point3_t = vec3_t<T>;
 using point3 = vec3;
 
 
 // Vector Utility Functions
+// Scalars are taken as 'typename vec3_t<T>::value_type', which is not used to deduce T, so 0.5 * v or v / 2 still compile when v is vec3_t<float>
 
-inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
+template <typename T>
+inline std::ostream& operator<<(std::ostream& out, const vec3_t<T>& v) {
     return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
 }
 
-inline vec3 operator+(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
+template <typename T>
+inline vec3_t<T> operator+(const vec3_t<T>& u, const vec3_t<T>& v) {
+    return vec3_t<T>(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
 }
 
-inline vec3 operator-(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
+template <typename T>
+inline vec3_t<T> operator-(const vec3_t<T>& u, const vec3_t<T>& v) {
+    return vec3_t<T>(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
 }
 
-inline vec3 operator*(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
+template <typename T>
+inline vec3_t<T> operator*(const vec3_t<T>& u, const vec3_t<T>& v) {
+    return vec3_t<T>(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
 }
 
-inline vec3 operator*(double t, const vec3& v) {
-    return vec3(t * v.e[0], t * v.e[1], t * v.e[2]);
+template <typename T>
+inline vec3_t<T> operator*(typename vec3_t<T>::value_type t, const vec3_t<T>& v) {
+    return vec3_t<T>(t * v.e[0], t * v.e[1], t * v.e[2]);
 }
 
-inline vec3 operator*(const vec3& v, double t) {
+template <typename T>
+inline vec3_t<T> operator*(const vec3_t<T>& v, typename vec3_t<T>::value_type t) {
     return t * v;
 }
 
-inline vec3 operator/(const vec3& v, double t) {
-    return (1 / t) * v;
+template <typename T>
+inline vec3_t<T> operator/(const vec3_t<T>& v, typename vec3_t<T>::value_type t) {
+    return (T(1) / t) * v;
 }
 
-inline double dot(const vec3& u, const vec3& v) {
+template <typename T>
+inline T dot(const vec3_t<T>& u, const vec3_t<T>& v) {
     return u.e[0] * v.e[0]
         + u.e[1] * v.e[1]
         + u.e[2] * v.e[2];
 }
 
-inline vec3 cross(const vec3& u, const vec3& v) {
-    return vec3(u.e[1] * v.e[2] - u.e[2] * v.e[1],
+template <typename T>
+inline vec3_t<T> cross(const vec3_t<T>& u, const vec3_t<T>& v) {
+    return vec3_t<T>(u.e[1] * v.e[2] - u.e[2] * v.e[1],
         u.e[2] * v.e[0] - u.e[0] * v.e[2],
         u.e[0] * v.e[1] - u.e[1] * v.e[0]);
 }
 
-inline vec3 unit_vector(const vec3& v) {
+template <typename T>
+inline vec3_t<T> unit_vector(const vec3_t<T>& v) {
     return v / v.length();
 }
 
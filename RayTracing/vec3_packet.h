@@ -0,0 +1,268 @@
+#ifndef VEC3_PACKET_H
+#define VEC3_PACKET_H
+
+#include "vec3.h"
+
+#include <cmath>
+
+/*
+Packet (SIMD-friendly) versions of the math in vec3.h: W vectors stored as Structure of Arrays (SoA).
+vec3 stores one vector as x,y,z next to each other (AoS), so an operation on it uses 3 lanes at most and vectorizes poorly.
+vec3_packet<T, W> stores W x-values, then W y-values, then W z-values, so "add the x components of 8 vectors" is one 8-wide instruction.
+Every operator is a short loop over the W lanes with no dependencies between lanes; with optimization on, the compiler turns each loop
+into one SSE/AVX/AVX-512 instruction (W = 4 floats fills SSE, 8 fills AVX, 16 fills AVX-512).
+
+Branches become masks: a comparison produces a mask_packet, and select(mask, a, b) picks a or b per lane instead of using if/else.
+load/store convert between an array of vec3 (AoS) and a packet (SoA).
+*/
+
+// W lanes of one scalar
+template <typename T, int W>
+struct packet {
+    static_assert(W > 0 && (W & (W - 1)) == 0, "packet width must be a power of two (4, 8, 16, ...)");
+    alignas(sizeof(T) * W) T v[W];
+
+    packet() = default;
+    explicit packet(T s) { for (int i = 0; i < W; i++) v[i] = s; }     // broadcast one value to all lanes
+
+    T operator[](int i) const { return v[i]; }
+    T& operator[](int i) { return v[i]; }
+};
+
+// One true/false per lane, e.g. "did the ray in this lane hit?"
+template <int W>
+struct mask_packet {
+    bool m[W];
+
+    bool operator[](int i) const { return m[i]; }
+    bool& operator[](int i) { return m[i]; }
+
+    bool any() const { bool r = false; for (int i = 0; i < W; i++) r |= m[i]; return r; }
+    bool all() const { bool r = true; for (int i = 0; i < W; i++) r &= m[i]; return r; }
+};
+
+// Lane-wise operators generated for every arithmetic and comparison operator, so each one is a single vectorizable loop
+#define VEC3_PACKET_BINARY_OP(OP)                                                                       \
+    template <typename T, int W>                                                                        \
+    inline packet<T, W> operator OP(const packet<T, W>& a, const packet<T, W>& b) {                     \
+        packet<T, W> r;                                                                                 \
+        for (int i = 0; i < W; i++) r.v[i] = a.v[i] OP b.v[i];                                          \
+        return r;                                                                                       \
+    }
+VEC3_PACKET_BINARY_OP(+)
+VEC3_PACKET_BINARY_OP(-)
+VEC3_PACKET_BINARY_OP(*)
+VEC3_PACKET_BINARY_OP(/)
+#undef VEC3_PACKET_BINARY_OP
+
+#define VEC3_PACKET_COMPARE_OP(OP)                                                                      \
+    template <typename T, int W>                                                                        \
+    inline mask_packet<W> operator OP(const packet<T, W>& a, const packet<T, W>& b) {                   \
+        mask_packet<W> r;                                                                               \
+        for (int i = 0; i < W; i++) r.m[i] = a.v[i] OP b.v[i];                                          \
+        return r;                                                                                       \
+    }
+VEC3_PACKET_COMPARE_OP(<)
+VEC3_PACKET_COMPARE_OP(<=)
+VEC3_PACKET_COMPARE_OP(>)
+VEC3_PACKET_COMPARE_OP(>=)
+#undef VEC3_PACKET_COMPARE_OP
+
+template <int W>
+inline mask_packet<W> operator&(const mask_packet<W>& a, const mask_packet<W>& b) {
+    mask_packet<W> r;
+    for (int i = 0; i < W; i++) r.m[i] = a.m[i] && b.m[i];
+    return r;
+}
+
+template <int W>
+inline mask_packet<W> operator|(const mask_packet<W>& a, const mask_packet<W>& b) {
+    mask_packet<W> r;
+    for (int i = 0; i < W; i++) r.m[i] = a.m[i] || b.m[i];
+    return r;
+}
+
+template <int W>
+inline mask_packet<W> operator!(const mask_packet<W>& a) {
+    mask_packet<W> r;
+    for (int i = 0; i < W; i++) r.m[i] = !a.m[i];
+    return r;
+}
+
+template <typename T, int W>
+inline packet<T, W> operator-(const packet<T, W>& a) {
+    packet<T, W> r;
+    for (int i = 0; i < W; i++) r.v[i] = -a.v[i];
+    return r;
+}
+
+template <typename T, int W>
+inline packet<T, W> sqrt(const packet<T, W>& a) {
+    packet<T, W> r;
+    for (int i = 0; i < W; i++) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+// Per lane: mask ? a : b (compiles to a blend instruction, no branch)
+template <typename T, int W>
+inline packet<T, W> select(const mask_packet<W>& mask, const packet<T, W>& a, const packet<T, W>& b) {
+    packet<T, W> r;
+    for (int i = 0; i < W; i++) r.v[i] = mask.m[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+
+// W 3D vectors in SoA form; same operator set as vec3
+template <typename T, int W>
+class vec3_packet {
+public:
+    using value_type = T;
+
+    packet<T, W> x, y, z;
+
+    vec3_packet() = default;
+    vec3_packet(const packet<T, W>& px, const packet<T, W>& py, const packet<T, W>& pz) : x(px), y(py), z(pz) {}
+    explicit vec3_packet(const vec3& v) : x(T(v.x())), y(T(v.y())), z(T(v.z())) {}     // same vector in every lane
+
+    static constexpr int width = W;
+
+    // Lane i as an ordinary vec3
+    vec3 lane(int i) const { return vec3(x.v[i], y.v[i], z.v[i]); }
+    void set_lane(int i, const vec3& v) { x.v[i] = T(v.x()); y.v[i] = T(v.y()); z.v[i] = T(v.z()); }
+
+    vec3_packet operator-() const { return vec3_packet(-x, -y, -z); }
+
+    vec3_packet& operator+=(const vec3_packet& v) { x = x + v.x; y = y + v.y; z = z + v.z; return *this; }
+    vec3_packet& operator*=(const packet<T, W>& t) { x = x * t; y = y * t; z = z * t; return *this; }
+    vec3_packet& operator*=(T t) { return *this *= packet<T, W>(t); }
+    vec3_packet& operator/=(T t) { return *this *= T(1) / t; }
+
+    packet<T, W> length_squared() const { return x * x + y * y + z * z; }
+    packet<T, W> length() const { return sqrt(length_squared()); }
+};
+
+// Aliases for the common register widths: 4 lanes = SSE, 8 = AVX, 16 = AVX-512 (for float; double lanes are twice as wide)
+using vec3x4f = vec3_packet<float, 4>;
+using vec3x8f = vec3_packet<float, 8>;
+using vec3x16f = vec3_packet<float, 16>;
+using vec3x4d = vec3_packet<double, 4>;
+using vec3x8d = vec3_packet<double, 8>;
+
+
+// Packet Utility Functions (mirror the vec3 ones)
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator+(const vec3_packet<T, W>& u, const vec3_packet<T, W>& v) {
+    return vec3_packet<T, W>(u.x + v.x, u.y + v.y, u.z + v.z);
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator-(const vec3_packet<T, W>& u, const vec3_packet<T, W>& v) {
+    return vec3_packet<T, W>(u.x - v.x, u.y - v.y, u.z - v.z);
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator*(const vec3_packet<T, W>& u, const vec3_packet<T, W>& v) {
+    return vec3_packet<T, W>(u.x * v.x, u.y * v.y, u.z * v.z);
+}
+
+// Per-lane scale (a different t for every vector) and uniform scale; as in vec3.h, the uniform scale's type is taken from the packet, not deduced,
+// so 0.5 * vec3x8f converts the double instead of failing to deduce T
+template <typename T, int W>
+inline vec3_packet<T, W> operator*(const packet<T, W>& t, const vec3_packet<T, W>& v) {
+    return vec3_packet<T, W>(t * v.x, t * v.y, t * v.z);
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator*(const vec3_packet<T, W>& v, const packet<T, W>& t) {
+    return t * v;
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator*(typename vec3_packet<T, W>::value_type t, const vec3_packet<T, W>& v) {
+    return packet<T, W>(t) * v;
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator*(const vec3_packet<T, W>& v, typename vec3_packet<T, W>::value_type t) {
+    return packet<T, W>(t) * v;
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator/(const vec3_packet<T, W>& v, const packet<T, W>& t) {
+    return (packet<T, W>(T(1)) / t) * v;
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> operator/(const vec3_packet<T, W>& v, typename vec3_packet<T, W>::value_type t) {
+    return (T(1) / t) * v;
+}
+
+template <typename T, int W>
+inline packet<T, W> dot(const vec3_packet<T, W>& u, const vec3_packet<T, W>& v) {
+    return u.x * v.x + u.y * v.y + u.z * v.z;
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> cross(const vec3_packet<T, W>& u, const vec3_packet<T, W>& v) {
+    return vec3_packet<T, W>(u.y * v.z - u.z * v.y,
+        u.z * v.x - u.x * v.z,
+        u.x * v.y - u.y * v.x);
+}
+
+template <typename T, int W>
+inline vec3_packet<T, W> unit_vector(const vec3_packet<T, W>& v) {
+    return v / v.length();
+}
+
+// Per lane: mask ? a : b
+template <typename T, int W>
+inline vec3_packet<T, W> select(const mask_packet<W>& mask, const vec3_packet<T, W>& a, const vec3_packet<T, W>& b) {
+    return vec3_packet<T, W>(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+}
+
+// Gather W consecutive vec3s (AoS) into a packet (SoA)
+template <typename T, int W>
+inline vec3_packet<T, W> load_packet(const vec3* src) {
+    vec3_packet<T, W> p;
+    for (int i = 0; i < W; i++) {
+        p.x.v[i] = T(src[i].x());
+        p.y.v[i] = T(src[i].y());
+        p.z.v[i] = T(src[i].z());
+    }
+    return p;
+}
+
+// Scatter a packet back into W consecutive vec3s
+template <typename T, int W>
+inline void store_packet(const vec3_packet<T, W>& p, vec3* dst) {
+    for (int i = 0; i < W; i++) dst[i] = vec3(p.x.v[i], p.y.v[i], p.z.v[i]);
+}
+
+// Only the first n lanes (n <= W) are loaded/stored; the rest of the packet is filled with zeros, for the tail of an array
+template <typename T, int W>
+inline vec3_packet<T, W> load_packet(const vec3* src, int n) {
+    vec3_packet<T, W> p(packet<T, W>(T(0)), packet<T, W>(T(0)), packet<T, W>(T(0)));
+    for (int i = 0; i < n && i < W; i++) p.set_lane(i, src[i]);
+    return p;
+}
+
+template <typename T, int W>
+inline void store_packet(const vec3_packet<T, W>& p, vec3* dst, int n) {
+    for (int i = 0; i < n && i < W; i++) dst[i] = p.lane(i);
+}
+
+
+// W rays at once: origins and directions as packets; at(t) evaluates every lane's ray at its own t
+template <typename T, int W>
+class ray_packet {
+public:
+    vec3_packet<T, W> orig, dir;
+
+    ray_packet() = default;
+    ray_packet(const vec3_packet<T, W>& origin, const vec3_packet<T, W>& direction) : orig(origin), dir(direction) {}
+
+    vec3_packet<T, W> at(const packet<T, W>& t) const { return orig + t * dir; }
+};
+
+#endif